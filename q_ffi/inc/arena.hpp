@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "q_ffi.h"
+
+namespace q_ffi
+{
+    /// @brief Bump allocator for marshaling temporaries (string terminators, packed structs, etc.).
+    /// @remark Memory is only ever released by rewinding to an earlier mark, and blocks are kept for reuse,
+    ///     so that once warmed up, marshaling makes no heap allocation at all.
+    ///     An arena must only be used by one thread at a time.
+    class Arena
+    {
+    public:
+        /// @brief Allocation position, to be rewound to.
+        struct Mark
+        {
+            std::size_t block;
+            std::size_t used;
+        };
+
+        /// @param block_size Size of the first block (later blocks double in size, as needed).
+        q_ffi_API explicit Arena(std::size_t block_size = 4096);
+
+        Arena(Arena const&) = delete;
+        Arena& operator=(Arena const&) = delete;
+
+        /// @brief The calling thread's own arena.
+        q_ffi_API static Arena& local() noexcept;
+
+        /// @brief Allocate @c size zero-filled bytes aligned to @c alignment (a power of 2).
+        q_ffi_API void* allocate(std::size_t size, std::size_t alignment);
+
+        Mark mark() const noexcept
+        { return Mark{ current_, blocks_.empty() ? 0 : blocks_[current_].used }; }
+
+        /// @brief Release everything allocated since @c to was taken.
+        /// @remark Blocks larger than @c kMaxRetained that become unused are freed.
+        q_ffi_API void rewind(Mark const& to) noexcept;
+
+        /// @brief Total size of the blocks held.
+        q_ffi_API std::size_t capacity() const noexcept;
+
+        static constexpr std::size_t kMaxRetained = 1u << 20;
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<char[]> data;
+            std::size_t size;
+            std::size_t used;
+        };
+
+        std::size_t block_size_;
+        std::vector<Block> blocks_;
+        std::size_t current_;
+    };
+
+    /// @brief Temporaries that must outlive a single native call, allocated from an arena
+    ///     (the calling thread's own by default), and released all at once when the scratch goes away.
+    /// @remark Scratches over the same arena must be released in the reverse order of their creation.
+    class Scratch
+    {
+    public:
+        Scratch() noexcept
+            : Scratch(Arena::local())
+        {}
+
+        explicit Scratch(Arena& arena) noexcept
+            : arena_{ arena }, mark_{ arena.mark() }
+        {}
+
+        ~Scratch()
+        { clear(); }
+
+        Scratch(Scratch const&) = delete;
+        Scratch& operator=(Scratch const&) = delete;
+
+        /// @brief Allocate @c size zero-filled bytes aligned to @c alignment.
+        void* allocate(std::size_t size, std::size_t alignment)
+        { return arena_.allocate(size, alignment); }
+
+        /// @brief Copy @c n chars from @c s into a NUL-terminated string.
+        q_ffi_API char const* terminate(char const* s, std::size_t n);
+
+        /// @brief Release everything allocated so far.
+        void clear() noexcept
+        { arena_.rewind(mark_); }
+
+    private:
+        Arena& arena_;
+        Arena::Mark mark_;
+    };
+
+}//namespace q_ffi
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "q_ffi.h"
+#include <k_compat.h>
+#include "kpointer.hpp"
+
+namespace q_ffi
+{
+    /// @brief Background thread running foreign calls asynchronously, with their results delivered back
+    ///     to q callbacks on the main thread.
+    /// @remark Completions are signaled through an event descriptor which is registered into q's event loop
+    ///     (via <code>sd1</code>) when running inside q, so that q stays responsive while calls are running.
+    ///     K objects are only ever created or released on the main thread.
+    class AsyncQueue
+    {
+    public:
+        /// @brief A unit of asynchronous work.
+        class Job
+        {
+        public:
+            virtual ~Job() = default;
+
+            /// @brief Do the work, on the background thread: no K objects may be touched.
+            virtual void run() noexcept = 0;
+
+            /// @brief Convert the outcome into a new K object, on the main thread.
+            virtual ::K finish() = 0;
+        };
+
+        q_ffi_API static AsyncQueue& instance();
+
+        ~AsyncQueue();
+
+        AsyncQueue(AsyncQueue const&) = delete;
+        AsyncQueue& operator=(AsyncQueue const&) = delete;
+
+        /// @brief Queue @c job for the background thread (main thread only).
+        /// @param callback A q function to be called with the job's result, or generic null to discard it.
+        /// @throw q::K_error If the event descriptor cannot be created on this platform.
+        q_ffi_API void submit(std::unique_ptr<Job> job, ::K callback);
+
+        /// @brief Deliver all completed jobs to their callbacks (main thread only).
+        /// @param wait If to block until all jobs submitted so far are delivered.
+        /// @return Number of jobs delivered.
+        /// @throw q::K_error The first error from any of the callbacks, once all completed jobs are delivered.
+        q_ffi_API std::size_t drain(bool wait = false);
+
+        /// @brief Number of jobs submitted but not delivered yet.
+        std::size_t pending() const noexcept
+        { return pending_; }
+
+        /// @brief If completions wake up q's event loop (i.e. if running inside q).
+        bool is_registered() const noexcept
+        { return registered_; }
+
+    private:
+        struct Entry
+        {
+            std::unique_ptr<Job> job;
+            q::K_ptr callback;
+        };
+
+        AsyncQueue();
+
+        void start();
+        void work();
+
+        /// @brief Event handler registered with <code>sd1</code>.
+        static ::K on_event(::I fd);
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        std::deque<Entry> queued_;
+        std::deque<Entry> completed_;
+        std::thread worker_;
+        bool stopping_;
+        int fd_;
+        bool registered_;
+        std::size_t pending_;
+    };
+
+}//namespace q_ffi
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "q_ffi.h"
+#include <k_compat.h>
+#include "library.hpp"
+#include "signature.hpp"
+#include "invoker.hpp"
+#include "prototype.hpp"
+#include "stats.hpp"
+#include "symbols.hpp"
+
+namespace q_ffi
+{
+    /// @brief Load-time options of a binding.
+    struct BindingOptions
+    {
+        /// @brief If the function is pure (or at least thread-safe), so that "each" mode calls
+        ///     may be partitioned across the worker threads.
+        bool parallel = false;
+
+        /// @brief Min number of items in each partition for "each" mode calls to go parallel.
+        std::size_t grain = 1u << 16;
+
+        /// @brief Name listed in the call statistics (e.g. the function's symbol).
+        std::string name;
+
+        /// @brief Native <code>void(void*)</code> function releasing the objects whose handles are returned
+        ///     (for a <code>"*"</code> result), or @c nullptr if they are not to be released.
+        FunctionPtr destructor = nullptr;
+    };
+
+    /// @brief A foreign function bound to its signature, with its invoker precompiled.
+    /// @remark All type parsing and symbol resolution happen once, during construction;
+    ///     each invocation only converts its arguments and jumps to the native code.
+    class Binding
+    {
+    public:
+        /// @param library Keeps the shared library hosting @c fn loaded while the binding is alive.
+        /// @remark The signature is compiled only if no other live binding shares it (see @c Prototype).
+        q_ffi_API Binding(FunctionPtr fn, Signature signature, std::shared_ptr<void> library = nullptr,
+            BindingOptions const& options = {});
+
+        /// @brief Bind function @c symbol from @c library, only resolved when first called.
+        /// @remark Resolution errors are thus deferred to the first call.
+        q_ffi_API Binding(std::shared_ptr<Library> library, std::string symbol, Signature signature,
+            BindingOptions const& options = {});
+
+        q_ffi_API ~Binding();
+
+        Binding(Binding const&) = delete;
+        Binding& operator=(Binding const&) = delete;
+
+        Signature const& signature() const noexcept
+        { return proto_->signature; }
+
+        /// @brief If the function is yet to be resolved.
+        bool is_lazy() const noexcept
+        { return nullptr == fn_; }
+
+        /// @brief Compiled signature, shared with all other bindings of the same signature.
+        Prototype const& prototype() const noexcept
+        { return *proto_; }
+
+        BindingOptions const& options() const noexcept
+        { return options_; }
+
+        /// @brief Number of arguments expected from q.
+        std::size_t rank() const noexcept
+        { return proto_->signature.rank(); }
+
+        /// @brief If a compile-time specialized thunk is used for exact-typed atom arguments.
+        bool is_specialized() const noexcept
+        { return nullptr != proto_->thunk; }
+
+        /// @brief Symbols interned from the function's (symbol) results.
+        SymbolCache const& symbols() const noexcept
+        { return symbols_; }
+
+        /// @brief Statistics of the calls made through @c operator() and @c apply (see @c CallStats::enable).
+        CallStats const& stats() const noexcept
+        { return stats_; }
+
+        /// @brief Invoke the foreign function.
+        /// @param args One @c K object per parameter.
+        /// @remark Tables passed to struct parameters are transposed into arrays of structs,
+        ///     and output struct buffers are transposed back into tables.
+        ///     Batched callbacks passed in are flushed once the foreign function returns,
+        ///     and the first error from any callback is then rethrown.
+        ///     With output buffer parameters, the result is the only output buffer (for a @c void function),
+        ///     or a general list of the function's result followed by all output buffers.
+        ///     If any argument is a list of a scalar parameter's type, the function is called once
+        ///     per item ("each" mode), with atom arguments broadcast, and the results collected in a list
+        ///     (except for handle results, which are not supported in "each" mode).
+        ///     For a variadic function (see @c Signature::is_open), the last argument is a list of
+        ///     the variadic arguments, whose types select the call shape: reals are promoted to floats,
+        ///     strings passed as <code>char const*</code> and lists as pointers (the items of a simple list
+        ///     being taken as atoms, a single list is to be enlisted). Each shape is compiled once
+        ///     and cached for later calls.
+        /// @throw q::K_error <code>'length</code> if list arguments are of different lengths.
+        q_ffi_API ::K operator()(::K const* args) const;
+
+        /// @brief Invoke the foreign function.
+        /// @param args A general or simple list with one item per parameter.
+        q_ffi_API ::K apply(::K args) const;
+
+        /// @brief Invoke the foreign function once per row of @c table, whose columns are matched
+        ///     to the parameters by position, and collect the results in a list.
+        /// @remark Columns are read in place, without boxing rows into atoms, as in "each" mode
+        ///     (and in parallel as well, if enabled for the binding).
+        /// @throw q::K_error <code>'rank</code> if the number of columns does not match the parameters,
+        ///     or <code>'type</code> if a column is not of its parameter's type, or for non-scalar parameters.
+        q_ffi_API ::K apply_rows(::K table) const;
+
+        /// @brief Invoke the foreign function on the async thread, and return at once.
+        /// @param binding A q foreign object created by @c to_q, kept alive until the call completes.
+        /// @param args As for @c apply. Lists are kept alive (and must not be modified) until the call completes.
+        /// @param callback A q function to be called with the result on the main thread, or generic null.
+        /// @throw q::K_error If the arguments would require "each" mode or callbacks, or the function
+        ///     is variadic, which are not supported.
+        q_ffi_API static void post(::K binding, ::K args, ::K callback);
+
+        /// @brief Transfer ownership of @c binding into a new q foreign object.
+        q_ffi_API static ::K to_q(std::unique_ptr<Binding> binding) noexcept;
+
+        /// @brief Retrieve the binding held by a q foreign object created by @c to_q.
+        /// @throw q::K_error If @c k is not such an object.
+        q_ffi_API static Binding& from_q(::K k);
+
+    private:
+        struct Frame;
+        class AsyncCall;
+
+        /// @brief Bind the function of @c parent to one call shape of its (open) variadic signature.
+        Binding(Binding const& parent, Signature shape);
+
+        /// @brief Resolve the function, if not done yet (main thread only).
+        /// @throw q::K_error If the symbol cannot be found.
+        void resolve() const
+        {
+            if (nullptr == fn_)
+                fn_ = resolver_->resolve(symbol_);
+        }
+
+        /// @brief @c operator() without statistics.
+        ::K call(::K const* args) const;
+
+        /// @brief @c apply without statistics.
+        ::K call_list(::K args) const;
+
+        /// @brief Call a variadic function through the binding of the shape of its variadic arguments.
+        ::K call_variadic(::K const* args) const;
+
+        /// @brief @c apply_rows without statistics.
+        ::K call_rows(::K table) const;
+
+        /// @brief Marshal <code>args[i]</code> if @c args is given, or item @c i of @c list otherwise.
+        ::K invoke(::K const* args, ::K list) const;
+
+        /// @brief Marshal the arguments of a single call into @c frame, and allocate its output buffers.
+        void prepare(Frame& frame, ::K const* args, ::K list) const;
+
+        /// @brief Convert the result of a single call, along with its output buffers.
+        ::K complete(Frame& frame) const;
+
+        /// @brief Convert the function's result, interning symbols through @c symbols_.
+        ::K unmarshal(Slot res) const;
+
+        /// @brief Call the foreign function for each of the @c n items in the list arguments.
+        ::K invoke_each(::K const* args, std::size_t n) const;
+
+        /// @brief Process items <code>[begin, end)</code> of an "each" mode call through the marshalers.
+        void each_range(::K const* args, ::K result, std::size_t begin, std::size_t end) const;
+
+        /// @brief Flush the batched callbacks among @c args, and report any error from the callbacks.
+        void settle_callbacks(::K const* args) const;
+
+        /// @brief If all arguments are atoms or lists of the exact parameter types.
+        bool is_exact(::K const* args) const noexcept;
+
+        /// @return Common length of list arguments in "each" mode, or @c npos if none is a list.
+        std::size_t each_count(::K const* args) const;
+
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        static ::K finalize(::K k);
+
+        std::shared_ptr<void> library_;
+        mutable FunctionPtr fn_;
+        /// @brief Library to resolve @c symbol_ from, for a lazy binding.
+        std::shared_ptr<Library> resolver_;
+        std::string symbol_;
+        BindingOptions options_;
+        std::shared_ptr<Prototype const> proto_;
+        mutable SymbolCache symbols_;
+        mutable CallStats stats_;
+        /// @brief Bindings of the call shapes of a variadic function, by type codes of the variadic arguments.
+        mutable std::unordered_map<std::string, std::unique_ptr<Binding>> shapes_;
+    };
+
+}//namespace q_ffi
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q_ffi.h"
+#include <k_compat.h>
+#include "kpointer.hpp"
+#include "signature.hpp"
+#include "invoker.hpp"
+#include "marshal.hpp"
+
+namespace q_ffi
+{
+    /// @brief Apply a q function to a list of arguments, through q's own <code>.</code> (looked up in the host
+    ///     process), on the main thread.
+    /// @throw q::K_error If the function signals an error, or if not running inside q.
+    q_ffi_API ::K evaluate(::K function, ::K args);
+
+    /// @brief Max number of callbacks alive at the same time (i.e. number of preassembled trampolines).
+    constexpr std::size_t kMaxCallbacks = 128;
+
+    /// @brief A q function callable from native code through a plain C function pointer.
+    /// @remark Each callback holds one of a fixed pool of trampolines, assembled at build time, which spill
+    ///     the argument registers and forward them to the callback's q function, so that nothing is generated
+    ///     or allocated per call. The trampoline is returned to the pool once the callback is released.
+    ///     Scalar parameters are passed to q as atoms; pointer parameters (e.g. <code>"F"</code> for
+    ///     <code>double const*</code>, as in @c qsort comparators) are dereferenced into atoms.
+    ///     In batched mode, the arguments of up to @c batch calls are buffered into lists, one per parameter,
+    ///     before the q function is called once with all of them; batched callbacks must return @c void.
+    ///     Callbacks may only be invoked from the thread that created them (q's main thread), while q is
+    ///     waiting on a foreign call: if a library invokes one from any other thread, the q function is not
+    ///     evaluated, a zero result is returned and an error is held instead.
+    ///     A q error is held until the foreign call returns (see @c check), as it cannot unwind native frames.
+    class Callback
+    {
+    public:
+        /// @param function Any q function of matching rank.
+        /// @param batch Number of calls buffered per evaluation, or 0 to evaluate each call.
+        /// @throw q::K_error If the signature is not supported, or if all trampolines are in use.
+        q_ffi_API Callback(::K function, Signature signature, std::size_t batch = 0);
+
+        q_ffi_API ~Callback();
+
+        Callback(Callback const&) = delete;
+        Callback& operator=(Callback const&) = delete;
+
+        Signature const& signature() const noexcept
+        { return signature_; }
+
+        std::size_t batch() const noexcept
+        { return batch_; }
+
+        /// @brief Native entry point, to be passed to foreign functions.
+        q_ffi_API FunctionPtr pointer() const noexcept;
+
+        /// @brief Evaluate the q function over any buffered calls (in batched mode).
+        /// @remark Errors are held as for any other invocation.
+        q_ffi_API void flush() noexcept;
+
+        /// @brief Rethrow (and clear) the first error held from any callback on this thread
+        ///     (or else from any callback invoked off its thread).
+        /// @throw q::K_error If any callback failed since the last check.
+        q_ffi_API static void check();
+
+        /// @brief Entry point of trampoline @c index, with its argument registers spilled into @c frame
+        ///     (laid out as for @c CallPlan) and @c stack pointing to its stack arguments.
+        ///     The result is returned in <code>frame[0]</code> or <code>frame[kIntRegs]</code>.
+        static void dispatch(std::size_t index, Slot* frame, Slot const* stack) noexcept;
+
+        /// @brief Transfer ownership of @c callback into a new q foreign object.
+        q_ffi_API static ::K to_q(std::unique_ptr<Callback> callback) noexcept;
+
+        /// @brief Retrieve the callback held by a q foreign object created by @c to_q.
+        /// @throw q::K_error If @c k is not such an object.
+        q_ffi_API static Callback& from_q(::K k);
+
+    private:
+        /// @brief Store the arguments of a call into the batch lists, evaluating once they are full.
+        void buffer(Slot* frame, Slot const* stack) noexcept;
+
+        /// @brief Evaluate the q function over the arguments of a call, and return its result into @c frame.
+        void evaluate(Slot* frame, Slot const* stack) noexcept;
+
+        static ::K finalize(::K k);
+
+        q::K_ptr function_;
+        Signature signature_;
+        CallPlan plan_;
+        std::vector<Unmarshaler> unmarshalers_;
+        std::vector<Storer> storers_;
+        Marshaler result_;
+        /// @brief Thread on which the q function may be evaluated.
+        std::thread::id thread_;
+        std::size_t index_;
+        std::size_t batch_;
+        std::vector<q::K_ptr> lists_;
+        std::size_t buffered_;
+        /// @brief Memory backing @c scratch_, owned by the callback.
+        Arena arena_;
+        /// @brief Strings returned from the last evaluation.
+        Scratch scratch_;
+    };
+
+}//namespace q_ffi
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "q_ffi.h"
+
+namespace q_ffi
+{
+    /// @brief Symbols exported by a loaded ELF library, read in-process from its dynamic symbol table
+    ///     (<code>.dynsym</code>, indexed by <code>.gnu.hash</code>, or by <code>.hash</code> for older libraries).
+    /// @remark Unlike @c dlsym, only the library itself is searched (not its dependencies),
+    ///     and only the default version of versioned symbols is seen.
+    ///     The library must stay loaded for as long as the reader is used.
+    class ElfExports
+    {
+    public:
+        enum class Kind : char
+        {
+            function = 'f',
+            data = 'd',
+            /// @brief GNU indirect function, whose address is that of its resolver.
+            indirect = 'i'
+        };
+
+        struct Symbol
+        {
+            char const* name;
+            void* address;
+            std::size_t size;
+            Kind kind;
+        };
+
+        /// @param handle Library handle, as returned by @c dlopen.
+        /// @throw q::K_error If the dynamic symbol table cannot be located (or the platform is not ELF-based).
+        q_ffi_API explicit ElfExports(void* handle);
+
+        /// @brief Number of entries in the symbol table (including undefined and local ones).
+        std::size_t size() const noexcept
+        { return count_; }
+
+        /// @brief All defined symbols exported by the library (functions and data), in table order.
+        q_ffi_API std::vector<Symbol> list() const;
+
+        /// @brief Look @c name up through the library's hash table.
+        /// @return Address of the symbol, @c nullptr if not exported or an indirect function
+        ///     (to be resolved by @c dlsym, which runs the resolver).
+        q_ffi_API void* find(char const* name) const noexcept;
+
+        /// @brief Look many symbols up in a single walk of the symbol table.
+        /// @return Addresses, in the order of @c names, with @c nullptr for those @c find would not return.
+        q_ffi_API std::vector<void*> find_all(std::vector<std::string> const& names) const;
+
+    private:
+        /// @brief Symbol at @c index, if defined and exported.
+        bool exported(std::size_t index, Symbol& symbol) const noexcept;
+
+        std::uintptr_t base_;
+        void const* symtab_;
+        char const* strtab_;
+        std::uint16_t const* versym_;
+        std::uint32_t const* gnu_hash_;
+        std::uint32_t const* sysv_hash_;
+        /// @brief First symbol indexed by the hash table.
+        std::size_t first_;
+        std::size_t count_;
+    };
+
+}//namespace q_ffi
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "ktype_traits.hpp"
+#include "kview.hpp"
+#include "std_ext.hpp"
+
+namespace q_ffi
+{
+    /// @brief Non-owning view over the items of a q list, as taken by exported functions.
+    template<typename T>
+    using span = std_ext::span<T>;
+
+    namespace details
+    {
+        template<typename T>
+        constexpr q::TypeId ktype_of() noexcept
+        {
+            using Value = std::remove_cv_t<T>;
+            if constexpr (std::is_void_v<Value>)
+                return q::kNil;     // before any sizeof
+            else if constexpr (std::is_same_v<Value, bool>)
+                return q::kBoolean;
+            else if constexpr (std::is_same_v<Value, char>)
+                return q::kChar;
+            else if constexpr (std::is_same_v<Value, unsigned char>)
+                return q::kByte;
+            else if constexpr (std::is_integral_v<Value> && std::is_signed_v<Value> && 2 == sizeof(Value))
+                return q::kShort;
+            else if constexpr (std::is_integral_v<Value> && std::is_signed_v<Value> && 4 == sizeof(Value))
+                return q::kInt;
+            else if constexpr (std::is_integral_v<Value> && std::is_signed_v<Value> && 8 == sizeof(Value))
+                return q::kLong;
+            else if constexpr (std::is_same_v<Value, float>)
+                return q::kReal;
+            else if constexpr (std::is_same_v<Value, double>)
+                return q::kFloat;
+            else if constexpr (std::is_same_v<Value, char const*>)
+                return q::kSymbol;
+            else
+                return q::kNil;
+        }
+
+    }//namespace q_ffi::details
+
+    /// @brief q type of the C++ scalar type @c T (@c kNil if there is none):
+    ///     @c bool, @c char, <code>unsigned char</code> (byte), signed integers of 2, 4 or 8 bytes,
+    ///     @c float, @c double, and <code>char const*</code> (symbol).
+    template<typename T>
+    constexpr q::TypeId ktype_v = details::ktype_of<T>();
+
+    namespace details
+    {
+        /// @brief Conversion of a q argument into a scalar parameter, with no coercion.
+        template<typename T>
+        struct Param
+        {
+            static constexpr q::TypeId tid = ktype_v<T>;
+            static_assert(q::kNil != tid, "unsupported parameter type");
+
+            static T from_q(::K k)
+            {
+                if (-tid != q::type(k))
+                    throw q::K_error("type");
+                return static_cast<T>(q::TypeTraits<tid>::value(k));
+            }
+        };
+
+        /// @brief Borrowed q object, passed through as is.
+        template<>
+        struct Param<::K>
+        {
+            static ::K from_q(::K k) noexcept
+            { return k; }
+        };
+
+        /// @brief View over the items of a simple list, with no copy.
+        template<typename T>
+        struct Param<span<T>>
+        {
+            static_assert(std::is_const_v<T>, "q lists are immutable: take a span<T const>");
+            static constexpr q::TypeId tid = ktype_v<T>;
+            static_assert(q::kNil != tid, "unsupported list item type");
+            static_assert(sizeof(T) == sizeof(typename q::TypeTraits<tid>::value_type), "item size");
+
+            static span<T> from_q(::K k)
+            {
+                q::KView<tid> const items{ k };
+                return span<T>{ reinterpret_cast<T*>(items.data()), items.size() };
+            }
+        };
+
+        /// @brief Conversion of a scalar result into a q atom.
+        template<typename Res>
+        struct Result
+        {
+            static constexpr q::TypeId tid = ktype_v<Res>;
+            static_assert(q::kNil != tid, "unsupported result type");
+
+            static ::K to_q(Res r)
+            {
+                using Value = typename q::TypeTraits<tid>::value_type;
+                return q::TypeTraits<tid>::atom(static_cast<Value>(r));
+            }
+        };
+
+        /// @brief Interned symbol, the null symbol for @c nullptr.
+        template<>
+        struct Result<char const*>
+        {
+            static ::K to_q(char const* r) noexcept
+            {
+                using Traits = q::TypeTraits<q::kSymbol>;
+                return Traits::atom(nullptr == r ? Traits::null() : r);
+            }
+        };
+
+        /// @brief New q object (whose ownership is passed to q).
+        template<>
+        struct Result<::K>
+        {
+            static ::K to_q(::K r) noexcept
+            { return r; }
+        };
+
+        template<typename T>
+        struct Result<std::vector<T>>
+        {
+            static constexpr q::TypeId tid = ktype_v<T>;
+            static_assert(q::kNil != tid, "unsupported list item type");
+
+            static ::K to_q(std::vector<T> const& r)
+            { return q::TypeTraits<tid>::list(r.cbegin(), r.cend()); }
+        };
+
+        template<std::size_t>
+        using KArg = ::K;
+
+        template<auto fn, typename Res, typename... Params>
+        struct Exporter
+        {
+            static constexpr std::size_t rank = sizeof...(Params);
+            static_assert(rank <= 8, "q functions take at most 8 arguments");
+
+            /// @brief Function to be called by q, with one @c K per parameter (and at least one).
+            template<std::size_t... I>
+            static ::K K4_DECL invoke(KArg<I>... args) noexcept
+            {
+                try {
+                    ::K const argv[] = { args... };
+                    return apply(argv, std::index_sequence_for<Params...>{});
+                }
+                catch (q::K_error const& ex) {
+                    return ex.report();
+                }
+                catch (std::exception const& ex) {
+                    return q::error(ex.what());
+                }
+            }
+
+            template<std::size_t... I>
+            static ::K apply(::K const* argv, std::index_sequence<I...>)
+            {
+                static_cast<void>(argv);
+                if constexpr (std::is_void_v<Res>) {
+                    fn(Param<std::decay_t<Params>>::from_q(argv[I])...);
+                    return q::TypeTraits<q::kNil>::atom();
+                }
+                else {
+                    return Result<std::decay_t<Res>>::to_q(fn(Param<std::decay_t<Params>>::from_q(argv[I])...));
+                }
+            }
+
+            template<std::size_t... I>
+            static constexpr auto wrapper(std::index_sequence<I...>) noexcept
+            { return &invoke<I...>; }
+        };
+
+        template<auto fn, typename Fn = decltype(fn)>
+        struct Exported;
+
+        template<auto fn, typename Res, typename... Params>
+        struct Exported<fn, Res(*)(Params...)> : Exporter<fn, Res, Params...>
+        {};
+
+        template<auto fn, typename Res, typename... Params>
+        struct Exported<fn, Res(*)(Params...) noexcept> : Exporter<fn, Res, Params...>
+        {};
+
+    }//namespace q_ffi::details
+
+    /// @brief Wrapper of the C++ function @c fn taking and returning q objects, to be called from q.
+    /// @remark The wrapper is generated at compile time from the signature of @c fn, mapping each parameter
+    ///     from its q argument (see @c ktype_v): atoms are type-checked, lists are passed as @c span views
+    ///     over their items, and @c K is passed through. Results are returned as atoms (or lists, from
+    ///     @c std::vector), @c void as the generic null. Exceptions are reported as q errors.
+    ///     The wrapper takes one @c K per parameter of @c fn, and a single ignored @c K if there is none
+    ///     (as q's <code>2:</code> requires at least one).
+    template<auto fn>
+    constexpr auto export_fn() noexcept
+    {
+        using Exported = details::Exported<fn>;
+        return Exported::wrapper(std::make_index_sequence<std::max<std::size_t>(Exported::rank, 1)>{});
+    }
+
+    /// @brief Number of parameters of @c fn.
+    template<auto fn>
+    constexpr std::size_t rank_v = details::Exported<fn>::rank;
+
+}//namespace q_ffi
+
+#ifdef _WIN32
+#   define q_ffi_EXPORT_API __declspec(dllexport)
+#else
+#   define q_ffi_EXPORT_API __attribute__((visibility("default")))
+#endif
+
+#define q_ffi_KPARAMS_0 ::K
+#define q_ffi_KPARAMS_1 ::K x1
+#define q_ffi_KPARAMS_2 q_ffi_KPARAMS_1, ::K x2
+#define q_ffi_KPARAMS_3 q_ffi_KPARAMS_2, ::K x3
+#define q_ffi_KPARAMS_4 q_ffi_KPARAMS_3, ::K x4
+#define q_ffi_KPARAMS_5 q_ffi_KPARAMS_4, ::K x5
+#define q_ffi_KPARAMS_6 q_ffi_KPARAMS_5, ::K x6
+#define q_ffi_KPARAMS_7 q_ffi_KPARAMS_6, ::K x7
+#define q_ffi_KPARAMS_8 q_ffi_KPARAMS_7, ::K x8
+
+#define q_ffi_KARGS_0 q::Nil
+#define q_ffi_KARGS_1 x1
+#define q_ffi_KARGS_2 q_ffi_KARGS_1, x2
+#define q_ffi_KARGS_3 q_ffi_KARGS_2, x3
+#define q_ffi_KARGS_4 q_ffi_KARGS_3, x4
+#define q_ffi_KARGS_5 q_ffi_KARGS_4, x5
+#define q_ffi_KARGS_6 q_ffi_KARGS_5, x6
+#define q_ffi_KARGS_7 q_ffi_KARGS_6, x7
+#define q_ffi_KARGS_8 q_ffi_KARGS_7, x8
+
+/// @brief Define the C function @c name, to be loaded with <code>name 2:(`name;rank)</code>,
+///     calling the C++ function @c fn (which must take @c rank parameters) through @c q_ffi::export_fn.
+/// @code{.cpp}
+///     double inner(q_ffi::span<double const> x, q_ffi::span<double const> y);
+///     q_ffi_EXPORT(qinner, &inner, 2)
+/// @endcode
+#define q_ffi_EXPORT(name, fn, rank) \
+    static_assert(rank == q_ffi::rank_v<fn>, #name ": rank mismatch"); \
+    q_ffi_EXTERN q_ffi_EXPORT_API ::K K4_DECL name(q_ffi_KPARAMS_##rank) \
+    { return q_ffi::export_fn<fn>()(q_ffi_KARGS_##rank); }
@@ -4,7 +4,77 @@
 #include <k_compat.h>
 
 q_ffi_EXTERN q_ffi_API
-K K4_DECL load(K dllSym, K fName, K resType, K parTypes);
+K K4_DECL load(K dllSym, K fName, K resType, K parTypes, K options);
 
 q_ffi_EXTERN q_ffi_API
-K K4_DECL version(K /*2: requires >= 1 arg*/);
\ No newline at end of file
+K K4_DECL bindAll(K dllSym, K manifest, K options);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL exports(K dllSym);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL unload(K dllSym);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL rank(K binding);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL call0(K binding, K /*2: requires >= 1 arg*/);
+q_ffi_EXTERN q_ffi_API
+K K4_DECL call1(K binding, K x1);
+q_ffi_EXTERN q_ffi_API
+K K4_DECL call2(K binding, K x1, K x2);
+q_ffi_EXTERN q_ffi_API
+K K4_DECL call3(K binding, K x1, K x2, K x3);
+q_ffi_EXTERN q_ffi_API
+K K4_DECL call4(K binding, K x1, K x2, K x3, K x4);
+q_ffi_EXTERN q_ffi_API
+K K4_DECL call5(K binding, K x1, K x2, K x3, K x4, K x5);
+q_ffi_EXTERN q_ffi_API
+K K4_DECL call6(K binding, K x1, K x2, K x3, K x4, K x5, K x6);
+q_ffi_EXTERN q_ffi_API
+K K4_DECL call7(K binding, K x1, K x2, K x3, K x4, K x5, K x6, K x7);
+q_ffi_EXTERN q_ffi_API
+K K4_DECL callv(K binding, K args);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL callRows(K binding, K table);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL post(K binding, K args, K callback);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL release(K handle);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL alloc(K type, K count, K alignment);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL copyIn(K buffer, K list);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL copyOut(K buffer);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL drain(K wait);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL callback(K function, K resType, K parTypes, K batch);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL flush(K callback);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL threads(K count);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL signatures(K /*2: requires >= 1 arg*/);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL stats(K reset);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL profile(K on);
+
+q_ffi_EXTERN q_ffi_API
+K K4_DECL version(K /*2: requires >= 1 arg*/);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+#include "q_ffi.h"
+#include <k_compat.h>
+#include "ktypes.hpp"
+#include "invoker.hpp"
+
+namespace q_ffi
+{
+    /// @brief Default alignment of native buffers: a cache line, as wide as an AVX-512 vector.
+    constexpr std::size_t kBufferAlignment = 64;
+
+    /// @brief An opaque native pointer (e.g. to a model or an order book built by a library), kept resident
+    ///     across foreign calls as a q foreign object.
+    /// @remark Handles are returned by functions with a <code>"*"</code> result, and passed back to their
+    ///     <code>"*"</code> parameters as is, so that native state needs not be rebuilt from q data on every call.
+    ///     The optional destructor (a native <code>void(void*)</code> function) runs once, when q releases
+    ///     the last reference to the handle or when it is released explicitly, whichever comes first.
+    ///     A handle may also own a native buffer of q items (see @c allocate), aligned beyond the 16 bytes
+    ///     of q list data, which is passed to pointer parameters of its item type in place of a list.
+    class Handle
+    {
+    public:
+        /// @param library Keeps the shared library hosting @c destructor loaded while the handle is alive.
+        q_ffi_API Handle(void* pointer, FunctionPtr destructor = nullptr, std::shared_ptr<void> library = nullptr);
+
+        /// @brief Allocate a zero-filled buffer of @c n items of the q simple list type @c tid.
+        /// @param alignment Alignment of the first item, a power of 2.
+        /// @throw q::K_error <code>'type</code> if @c tid is not a simple list type (or is @c kSymbol),
+        ///     <code>'domain</code> for an invalid alignment, or <code>'wsfull</code> if out of memory
+        ///     (or if @c n items would not fit a q list or the address space).
+        q_ffi_API static std::unique_ptr<Handle> allocate(q::TypeId tid, std::size_t n,
+            std::size_t alignment = kBufferAlignment);
+
+        q_ffi_API ~Handle();
+
+        Handle(Handle const&) = delete;
+        Handle& operator=(Handle const&) = delete;
+
+        /// @brief Native pointer, or @c nullptr once released.
+        void* get() const noexcept
+        { return pointer_; }
+
+        FunctionPtr destructor() const noexcept
+        { return destructor_; }
+
+        /// @brief If the handle owns a buffer of q items.
+        bool is_buffer() const noexcept
+        { return q::kNil != type_; }
+
+        /// @brief Item type of a buffer (or @c kNil for an opaque pointer).
+        q::TypeId type() const noexcept
+        { return type_; }
+
+        /// @brief Item count of a buffer (or 0 for an opaque pointer).
+        std::size_t count() const noexcept
+        { return count_; }
+
+        /// @brief Copy the items of @c list (of the buffer's type) to the start of the buffer.
+        /// @throw q::K_error <code>'type</code> for a list of another type (or an opaque pointer),
+        ///     or <code>'length</code> for a list longer than the buffer.
+        q_ffi_API void copy_in(::K list);
+
+        /// @brief Copy the items of the buffer into a new q list.
+        /// @throw q::K_error <code>'type</code> for an opaque pointer.
+        q_ffi_API ::K copy_out() const;
+
+        /// @brief Run the destructor on the native pointer (if not done yet), and clear it.
+        q_ffi_API void release() noexcept;
+
+        /// @brief Transfer ownership of @c handle into a new q foreign object.
+        q_ffi_API static ::K to_q(std::unique_ptr<Handle> handle) noexcept;
+
+        /// @brief Retrieve the handle held by a q foreign object created by @c to_q.
+        /// @throw q::K_error If @c k is not such an object.
+        q_ffi_API static Handle& from_q(::K k);
+
+    private:
+        static ::K finalize(::K k);
+
+        /// @throw q::K_error If the handle is not a buffer, or has been released.
+        void check_buffer() const;
+
+        void* pointer_;
+        FunctionPtr destructor_;
+        std::shared_ptr<void> library_;
+        q::TypeId type_;
+        std::size_t count_;
+    };
+
+}//namespace q_ffi
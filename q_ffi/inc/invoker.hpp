@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "q_ffi.h"
+#include "signature.hpp"
+
+#if (defined(__x86_64__) || defined(__amd64__)) && !defined(_WIN32)
+#   define q_ffi_SYSV_CALL 1
+#endif
+
+namespace q_ffi
+{
+    /// @brief Type-erased pointer to a foreign function.
+    using FunctionPtr = void (*)();
+
+    /// @brief Raw 64-bit native argument/result value.
+    /// @remark Integers are sign- or zero-extended, pointers are stored as-is,
+    ///     while floating-point values are stored as their IEEE 754 bit patterns.
+    using Slot = std::uint64_t;
+
+    /// @brief Native call stub, specialized for a given layout of argument classes.
+    using CallFn = Slot (*)(FunctionPtr fn, Slot const* args);
+
+    /// @brief Max number of native arguments supported by the generic call stubs.
+    constexpr std::size_t kMaxCallArgs = 6;
+
+    /// @brief Pick the call stub matching @c sig (to be done once, at load time).
+    /// @throw q::K_error If the signature cannot be handled on this platform.
+    q_ffi_API CallFn select_call(Signature const& sig);
+
+    /// @brief Register/stack layout of a native call under the x86-64 System V ABI.
+    /// @remark The layout is planned once per signature, so that each call only needs to scatter
+    ///     its arguments into a frame of <code>kStackBase + stack_words()</code> words:
+    ///     integer registers first, then vector registers, then the stack words in push order.
+    class CallPlan
+    {
+    public:
+        static constexpr std::size_t kIntRegs = 6;
+        static constexpr std::size_t kSseRegs = 8;
+        static constexpr std::size_t kStackBase = kIntRegs + kSseRegs;
+
+        /// @throw q::K_error If not supported on this platform.
+        q_ffi_API explicit CallPlan(Signature const& sig);
+
+        std::size_t int_regs() const noexcept
+        { return intRegs_; }
+
+        std::size_t sse_regs() const noexcept
+        { return sseRegs_; }
+
+        std::size_t stack_words() const noexcept
+        { return stackWords_; }
+
+        /// @brief Frame word receiving each argument.
+        std::vector<std::size_t> const& layout() const noexcept
+        { return layout_; }
+
+        q_ffi_API Slot operator()(FunctionPtr fn, Slot const* args) const;
+
+    private:
+        std::vector<std::size_t> layout_;
+        std::size_t intRegs_;
+        std::size_t sseRegs_;
+        std::size_t stackWords_;
+        NativeClass result_;
+    };
+
+    /// @brief Call engine for a given signature: a generic call stub if there is one,
+    ///     otherwise a planned call.
+    /// @remark Variadic functions are always called through a @c CallPlan, which passes the number of
+    ///     vector registers used in @c al, as they expect under the System V ABI.
+    class Invoker
+    {
+    public:
+        /// @throw q::K_error If the signature cannot be handled on this platform.
+        q_ffi_API explicit Invoker(Signature const& sig);
+
+        /// @brief If calls go through a @c CallPlan rather than a generic call stub.
+        bool is_planned() const noexcept
+        { return plan_.has_value(); }
+
+        Slot operator()(FunctionPtr fn, Slot const* args) const
+        { return nullptr != stub_ ? stub_(fn, args) : (*plan_)(fn, args); }
+
+    private:
+        CallFn stub_;
+        std::optional<CallPlan> plan_;
+    };
+
+    /// @brief Convert a symbol resolved by @c dlsym into a callable pointer.
+    inline FunctionPtr to_function(void* sym) noexcept
+    {
+        return reinterpret_cast<FunctionPtr>(reinterpret_cast<std::uintptr_t>(sym));
+    }
+
+}//namespace q_ffi
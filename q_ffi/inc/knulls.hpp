@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "q_ffi.h"
+#include "ktype_traits.hpp"
+#include "kview.hpp"
+
+namespace q {
+
+    namespace details
+    {
+        /// @brief Bit pattern of a value of up to 8 bytes, in its low-order bytes (as laid out in memory).
+        template<typename Value>
+        std::uint64_t bits_of(Value const& v) noexcept
+        {
+            static_assert(sizeof(Value) <= sizeof(std::uint64_t), "value too wide for a pattern");
+            std::uint64_t bits = 0;
+            std::memcpy(&bits, &v, sizeof(Value));
+            return bits;
+        }
+
+        /// @name Kernels matching @c n items of @c width bytes (1, 2, 4 or 8) against bit patterns,
+        ///     as @c NullableType::is_null and @c NumericType::is_inf do (so that NaN nulls are told apart
+        ///     from other NaNs). AVX2 is used if the CPU supports it, with a scalar fallback.
+        /// @{
+
+        /// @brief Number of items equal to @c pattern.
+        q_ffi_API std::size_t count_equal(void const* data, std::size_t n, std::size_t width,
+            std::uint64_t pattern) noexcept;
+
+        /// @brief Index of the first item equal to either pattern, @c n if none.
+        q_ffi_API std::size_t find_equal(void const* data, std::size_t n, std::size_t width,
+            std::uint64_t pattern, std::uint64_t other) noexcept;
+
+        /// @brief Set <code>mask[i]</code> to 1 for items equal to @c pattern, 0 for the others.
+        q_ffi_API void mask_equal(void const* data, std::size_t n, std::size_t width,
+            std::uint64_t pattern, std::uint8_t* mask) noexcept;
+
+        /// @brief Set bit <code>i % 64</code> of <code>bitmap[i / 64]</code> for items equal to @c pattern,
+        ///     clearing all others (<code>(n + 63) / 64</code> words).
+        q_ffi_API void bitmap_equal(void const* data, std::size_t n, std::size_t width,
+            std::uint64_t pattern, std::uint64_t* bitmap) noexcept;
+
+        /// @}
+
+        /// @brief Symbols are pointers to interned strings, whose null is the empty one.
+        inline bool is_null_symbol(char const* s) noexcept
+        { return nullptr == s || '\0' == *s; }
+
+    }//namespace q::details
+
+    /// @brief Number of nulls in @c items.
+    template<TypeId tid>
+    std::size_t count_nulls(KView<tid> const& items) noexcept
+    {
+        static_assert(has_null_v<tid>, "type without null");
+        if constexpr (kSymbol == tid) {
+            return static_cast<std::size_t>(std::count_if(items.begin(), items.end(), &details::is_null_symbol));
+        }
+        else {
+            return details::count_equal(items.data(), items.size(), sizeof(typename KView<tid>::value_type),
+                details::bits_of(TypeTraits<tid>::null()));
+        }
+    }
+
+    /// @brief Index of the first null in @c items, <code>items.size()</code> if none.
+    template<TypeId tid>
+    std::size_t find_first_null(KView<tid> const& items) noexcept
+    {
+        static_assert(has_null_v<tid>, "type without null");
+        if constexpr (kSymbol == tid) {
+            return static_cast<std::size_t>(
+                std::find_if(items.begin(), items.end(), &details::is_null_symbol) - items.begin());
+        }
+        else {
+            auto const null = details::bits_of(TypeTraits<tid>::null());
+            return details::find_equal(items.data(), items.size(), sizeof(typename KView<tid>::value_type),
+                null, null);
+        }
+    }
+
+    /// @brief Boolean list flagging the nulls in @c items (as q's <code>null</code>).
+    template<TypeId tid>
+    ::K null_mask(KView<tid> const& items) noexcept
+    {
+        static_assert(has_null_v<tid>, "type without null");
+        auto const mask = ::ktn(kBoolean, static_cast<::J>(items.size()));
+        auto const flags = reinterpret_cast<std::uint8_t*>(kG(mask));
+        if constexpr (kSymbol == tid) {
+            std::transform(items.begin(), items.end(), flags,
+                [](char const* s) { return static_cast<std::uint8_t>(details::is_null_symbol(s)); });
+        }
+        else {
+            details::mask_equal(items.data(), items.size(), sizeof(typename KView<tid>::value_type),
+                details::bits_of(TypeTraits<tid>::null()), flags);
+        }
+        return mask;
+    }
+
+    /// @brief Packed bitmap of the nulls in @c items: bit <code>i % 64</code> of word <code>i / 64</code>
+    ///     is set if item @c i is null.
+    template<TypeId tid>
+    std::vector<std::uint64_t> null_bitmap(KView<tid> const& items)
+    {
+        static_assert(has_null_v<tid>, "type without null");
+        std::vector<std::uint64_t> bitmap((items.size() + 63) / 64);
+        if constexpr (kSymbol == tid) {
+            for (std::size_t i = 0; i < items.size(); ++i) {
+                if (details::is_null_symbol(items[i]))
+                    bitmap[i / 64] |= std::uint64_t{ 1 } << (i % 64);
+            }
+        }
+        else {
+            details::bitmap_equal(items.data(), items.size(), sizeof(typename KView<tid>::value_type),
+                details::bits_of(TypeTraits<tid>::null()), bitmap.data());
+        }
+        return bitmap;
+    }
+
+    /// @brief If any of @c items is infinite (either <code>0W</code> or <code>-0W</code>).
+    template<TypeId tid>
+    bool has_any_inf(KView<tid> const& items) noexcept
+    {
+        static_assert(is_numeric_v<tid>, "type without infinities");
+        return items.size() != details::find_equal(items.data(), items.size(),
+            sizeof(typename KView<tid>::value_type),
+            details::bits_of(TypeTraits<tid>::inf(true)), details::bits_of(TypeTraits<tid>::inf(false)));
+    }
+
+}//namespace q
@@ -3,6 +3,7 @@
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <cstdint>
 #include <algorithm>
 #include <iterator>
 #include <sstream>
@@ -1027,6 +1028,33 @@ namespace q {
         { return Nil; }
     };
 
+    /// @brief Foreign objects are 2-item lists of (finalizer; native pointer), with type set to 112.
+    /// @remark q invokes the finalizer when the last reference to the object is released.
+    template<>
+    struct TypeTraits<kForeign>
+    {
+        static constexpr TypeId type_id = kForeign;
+        using value_type = void*;
+        using finalizer_type = ::K (*)(::K);
+
+        static ::K atom(value_type p, finalizer_type fin) noexcept
+        {
+            ::K k = ::knk(2, reinterpret_cast<::K>(reinterpret_cast<std::uintptr_t>(fin)), p);
+            k->t = type_id;
+            return k;
+        }
+
+        static value_type value(::K k) noexcept
+        { return kK(k)[1]; }
+
+        static finalizer_type finalizer(::K k) noexcept
+        { return reinterpret_cast<finalizer_type>(reinterpret_cast<std::uintptr_t>(kK(k)[0])); }
+
+        /// @brief Check if @c k is a foreign object with the given finalizer (i.e. created by us).
+        static bool is_foreign(::K k, finalizer_type fin) noexcept
+        { return type_id == type(k) && 2 == k->n && fin == finalizer(k); }
+    };
+
     template<>
     struct TypeTraits<kError> : public
         ValueType<TypeTraits<kError>, char const*>
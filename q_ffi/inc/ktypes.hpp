@@ -33,6 +33,7 @@ namespace q
         kTable = (XT),
         kDict = (XD),
         kNil = 101,
+        kForeign = 112,
         kError = -128
     };
 
@@ -59,6 +60,10 @@ namespace q
     /// @param sys If the error should be prepended with system error message.
     q_ffi_API ::K error(char const* msg, bool sys = false) noexcept;
 
+    /// @brief Extract plain text from a symbol atom, a char atom or a char list.
+    /// @throw K_error If @c k is of any other type.
+    q_ffi_API std::string q2Str(::K const k);
+
     /// @brief Stringize any @c K object as much as possible.
     ///     If the q type is recognized, @c k is converted using the @c to_str method in the respective type traits.
     q_ffi_API std::string to_string(::K const k);
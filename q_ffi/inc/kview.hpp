@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include "ktype_traits.hpp"
+#include "std_ext.hpp"
+
+namespace q {
+
+    /// @brief Non-owning view over the items of a q simple (or general) list of type @c tid,
+    ///     as a contiguous range for standard algorithms, without copying.
+    /// @remark The list type is checked once, at construction, and its data pointer and count are cached,
+    ///     so that no access goes through @c q::type or @c q::count again.
+    ///     The view holds no reference: the list must outlive it, and must not be resized meanwhile.
+    template<TypeId tid>
+    class KView
+    {
+    public:
+        using value_type = typename TypeTraits<tid>::value_type;
+        using size_type = std::size_t;
+        using pointer = value_type*;
+        using reference = value_type&;
+        using iterator = pointer;
+
+        /// @throw K_error <code>'type</code> if @c k is not a list of type @c tid.
+        explicit KView(::K k)
+            : data_{ nullptr }, size_{ 0 }
+        {
+            if (!is_list(k))
+                throw K_error("type");
+            data_ = TypeTraits<tid>::index(k);
+            size_ = count(k);
+        }
+
+        /// @brief If @c k is a list that can be viewed.
+        static bool is_list(::K k) noexcept
+        { return nullptr != k && tid == type(k); }
+
+        pointer data() const noexcept
+        { return data_; }
+
+        size_type size() const noexcept
+        { return size_; }
+
+        bool empty() const noexcept
+        { return 0 == size_; }
+
+        iterator begin() const noexcept
+        { return data_; }
+
+        iterator end() const noexcept
+        { return data_ + size_; }
+
+        reference operator[](size_type i) const noexcept
+        {
+            assert(i < size_);
+            return data_[i];
+        }
+
+        operator std_ext::span<value_type>() const noexcept
+        { return std_ext::span<value_type>{ data_, size_ }; }
+
+        operator std_ext::span<value_type const>() const noexcept
+        { return std_ext::span<value_type const>{ data_, size_ }; }
+
+    private:
+        pointer data_;
+        size_type size_;
+    };
+
+}//namespace q
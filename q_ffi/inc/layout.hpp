@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "q_ffi.h"
+#include <k_compat.h>
+#include "ktypes.hpp"
+
+namespace q_ffi
+{
+    /// @brief One field of a C struct, as seen from a column of a q table.
+    struct Field
+    {
+        /// @brief Copy items <code>[begin, end)</code> of a column into the field of consecutive structs.
+        using Packer = void (*)(Field const& field, ::K column, char* rows, std::size_t stride,
+            std::size_t begin, std::size_t end);
+
+        /// @brief Copy the field of consecutive structs into items <code>[begin, end)</code> of a column.
+        using Unpacker = void (*)(Field const& field, char const* rows, std::size_t stride, ::K column,
+            std::size_t begin, std::size_t end);
+
+        std::string name;       ///< Column name
+        char code;              ///< Type code, as in @c q::TypeCode
+        q::TypeId type_id;      ///< q type of the column's items
+        std::size_t size;       ///< Native item width in bytes (also its alignment)
+        std::size_t extent;     ///< Item count of a fixed-size array field, or 0 for a scalar field
+        std::size_t offset;     ///< Byte offset within the struct
+        Packer pack;
+        Unpacker unpack;
+
+        /// @brief Total width of the field in bytes.
+        std::size_t width() const noexcept
+        { return 0 == extent ? size : size * extent; }
+    };
+
+    /// @brief Layout of a C struct, laid out as the C compiler would on the target platform
+    ///     (each field naturally aligned, with padding in between and at the end).
+    /// @remark Fields are specified by their type codes (as in @c Signature), optionally followed by an
+    ///     item count for a fixed-size array (e.g. <code>"c8"</code> for <code>char[8]</code>), and optionally
+    ///     named by a prefix (e.g. <code>"sym:c8"</code>). Fields are separated by spaces or <code>";"</code>,
+    ///     which may be omitted between unnamed fields. Unnamed fields get q's default column names
+    ///     (<code>x</code>, <code>x1</code>, <code>x2</code>...).
+    ///     An array field maps to a column of lists (e.g. strings for <code>char[8]</code>),
+    ///     where a shorter list is padded with zeros, and a <code>char</code> array is truncated at its first NUL.
+    ///     A symbol field is a <code>char const*</code>.
+    class StructLayout
+    {
+    public:
+        /// @throw q::K_error If any of the fields is malformed or of an unsupported type.
+        q_ffi_API explicit StructLayout(std::string const& fields);
+
+        std::vector<Field> const& fields() const noexcept
+        { return fields_; }
+
+        /// @brief <code>sizeof</code> the struct, including any tail padding.
+        std::size_t size() const noexcept
+        { return size_; }
+
+        /// @brief <code>alignof</code> the struct.
+        std::size_t alignment() const noexcept
+        { return alignment_; }
+
+        /// @brief Canonical textual form of the layout, e.g. <code>{sym:c8;bid:f;ask:f}</code>
+        q_ffi_API std::string to_str() const;
+
+        /// @brief Number of rows in a table (0 for generic null).
+        /// @throw q::K_error If @c table is not an unkeyed table.
+        q_ffi_API static std::size_t rows(::K table);
+
+        /// @brief Transpose all rows of @c table into an array of structs at @c out.
+        /// @remark Columns are matched to fields by position, and must be of the exact field types.
+        ///     Rows are copied in blocks that fit in the L1 cache, so that the strided writes of each column
+        ///     hit the lines already brought in by the previous columns.
+        /// @param out At least <code>rows(table) * size()</code> bytes, aligned to @c alignment().
+        /// @throw q::K_error If @c table does not match the layout.
+        q_ffi_API void pack(::K table, void* out) const;
+
+        /// @brief Transpose @c n structs at @c in into a new table.
+        /// @remark Symbol fields are interned, so this must be called from the main thread.
+        q_ffi_API ::K unpack(void const* in, std::size_t n) const;
+
+    private:
+        std::vector<Field> fields_;
+        std::size_t size_;
+        std::size_t alignment_;
+    };
+
+}//namespace q_ffi
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "q_ffi.h"
+#include <dlfcn.h>
+#include "invoker.hpp"
+#include "elf.hpp"
+
+namespace q_ffi
+{
+    /// @brief A shared library opened through the process-wide library cache.
+    /// @remark Bindings hold a @c std::shared_ptr to the library hosting their function,
+    ///     so that the library is closed by @c dlclose only when the last of them is released.
+    class Library
+    {
+    public:
+        /// @brief Default @c dlopen flags.
+        static constexpr int kDefaultFlags = RTLD_NOW | RTLD_LOCAL;
+
+        /// @brief Get the library at @c path from the cache, opening it if necessary.
+        /// @param path An empty path refers to the host process itself.
+        /// @param flags @c dlopen flags, only applied when the library is actually opened.
+        /// @remark The cache keeps the library loaded (even without any binding) until @c unload.
+        /// @throw q::K_error If the library cannot be opened.
+        q_ffi_API static std::shared_ptr<Library> open(std::string const& path, int flags = kDefaultFlags);
+
+        /// @brief Release the cache's own reference to the library at @c path,
+        ///     so that it is closed once the last binding into it is released.
+        /// @return If the library was in the cache and not unloaded yet.
+        q_ffi_API static bool unload(std::string const& path);
+
+        ~Library();
+
+        Library(Library const&) = delete;
+        Library& operator=(Library const&) = delete;
+
+        /// @brief Canonical path of the library (empty for the host process).
+        std::string const& path() const noexcept
+        { return path_; }
+
+        int flags() const noexcept
+        { return flags_; }
+
+        /// @brief Resolve a function exported by the library, memoizing the result.
+        /// @throw q::K_error If the symbol cannot be found.
+        q_ffi_API FunctionPtr resolve(std::string const& name);
+
+        /// @brief Resolve many functions at once, in a single walk of the library's symbol table,
+        ///     falling back to @c dlsym for those not found there (e.g. exported by a dependency).
+        /// @return Functions in the order of @c names.
+        /// @throw q::K_error If any symbol cannot be found.
+        q_ffi_API std::vector<FunctionPtr> resolve(std::vector<std::string> const& names);
+
+        /// @brief Look up a symbol (function or data) exported by the library itself.
+        /// @return @c nullptr if not found.
+        q_ffi_API void* find(std::string const& name) noexcept;
+
+        /// @brief Reader of the library's own exports, created on first use.
+        /// @throw q::K_error If the symbol table cannot be read.
+        q_ffi_API ElfExports const& exports();
+
+    private:
+        Library(void* handle, std::string path, int flags) noexcept;
+
+        void* handle_;
+        std::string path_;
+        int flags_;
+        std::mutex mutex_;
+        std::unordered_map<std::string, FunctionPtr> symbols_;
+        std::unique_ptr<ElfExports> exports_;
+    };
+
+}//namespace q_ffi
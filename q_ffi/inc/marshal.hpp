@@ -0,0 +1,42 @@
+#pragma once
+
+#include "q_ffi.h"
+#include <k_compat.h>
+#include "arena.hpp"
+#include "signature.hpp"
+#include "invoker.hpp"
+
+namespace q_ffi
+{
+    /// @brief Item width of a q list type (0 if not a simple list).
+    q_ffi_API std::size_t item_size(q::TypeId tid) noexcept;
+
+    /// @brief Conversion from a q value into a native argument.
+    /// @param arg An atom, or a list whose @c i-th item is to be converted.
+    /// @throw q::K_error If @c arg is not of the expected type.
+    using Marshaler = Slot (*)(::K arg, std::size_t i, Scratch& scratch);
+
+    /// @brief Conversion from a native result into a new q atom.
+    using Unmarshaler = ::K (*)(Slot res);
+
+    /// @brief Conversion from a native result into item @c i of a q list (for "each" mode).
+    using Storer = void (*)(::K list, std::size_t i, Slot res);
+
+    /// @brief Pick the argument conversion for @c par (to be done once, at load time).
+    /// @remark The marshaler of a @c ParamKind::kCount parameter is to be given the argument of
+    ///     the pointer parameter it refers to.
+    /// @return @c nullptr for a @c ParamKind::kOutput parameter, which is allocated by the caller,
+    ///     or for a struct parameter, which is packed by the caller.
+    q_ffi_API Marshaler select_marshaler(Parameter const& par);
+
+    /// @brief Pick the conversion of a q list into a pointer to its items, of the type of @c par.
+    q_ffi_API Marshaler select_pointer_marshaler(Parameter const& par);
+
+    /// @brief Pick the result conversion for @c res (to be done once, at load time).
+    q_ffi_API Unmarshaler select_unmarshaler(Parameter const& res);
+
+    /// @brief Pick the result conversion into list items for @c res (to be done once, at load time).
+    /// @return @c nullptr for a @c void result.
+    q_ffi_API Storer select_storer(Parameter const& res);
+
+}//namespace q_ffi
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "q_ffi.h"
+#include <k_compat.h>
+#include "signature.hpp"
+#include "invoker.hpp"
+#include "marshal.hpp"
+#include "thunk.hpp"
+
+namespace q_ffi
+{
+    /// @brief A signature compiled for calls: its invoker, thunks, conversions, and parameter tables.
+    /// @remark Prototypes are interned by the canonical form of their signature (see @c Signature::to_str),
+    ///     so that all bindings of the same signature share a single one, which is only compiled once.
+    ///     They are immutable, and released once the last binding using them is.
+    struct Prototype
+    {
+        /// @throw q::K_error If the signature cannot be handled on this platform.
+        q_ffi_API explicit Prototype(Signature sig);
+
+        Prototype(Prototype const&) = delete;
+        Prototype& operator=(Prototype const&) = delete;
+
+        /// @brief Get the prototype of @c sig from the registry, compiling it if necessary.
+        /// @param user Name of the function to be listed as using the prototype (see @c release).
+        q_ffi_API static std::shared_ptr<Prototype const> intern(Signature sig, std::string const& user = {});
+
+        /// @brief Stop listing @c user as using @c proto.
+        q_ffi_API static void release(Prototype const& proto, std::string const& user) noexcept;
+
+        /// @brief A table with one row per live prototype, in canonical signature order:
+        ///     <code>signature rank invoker functions</code>, where @c invoker is one of
+        ///     <code>`thunk`stub`plan</code> and @c functions lists the functions using the prototype.
+        q_ffi_API static ::K table();
+
+        /// @brief Number of signatures in the registry (each dropped along with its prototype).
+        q_ffi_API static std::size_t registered() noexcept;
+
+        /// @brief Kind of call engine, as listed by @c table.
+        q_ffi_API char const* invoker_kind() const noexcept;
+
+        Signature const signature;
+        Thunk const thunk;
+        EachThunk const each_thunk;
+        Invoker const invoker;
+        std::vector<Marshaler> marshalers;
+        /// @brief Index of the q argument each native parameter is marshaled from (or sized after).
+        std::vector<std::size_t> sources;
+        /// @brief Indices of output buffer parameters.
+        std::vector<std::size_t> outputs;
+        /// @brief Indices of struct (table) parameters passed from q.
+        std::vector<std::size_t> structs;
+        /// @brief Indices of callback parameters.
+        std::vector<std::size_t> callbacks;
+        Unmarshaler const unmarshaler;
+        /// @brief Result conversion in "each" mode (leaving symbols to be interned by the caller).
+        Storer const storer;
+    };
+
+}//namespace q_ffi
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "q_ffi.h"
+#include "ktypes.hpp"
+#include "layout.hpp"
+
+namespace q_ffi
+{
+    /// @brief How a value travels between the call engine and native code.
+    enum class NativeClass : char
+    {
+        kVoid,      ///< No value (result only)
+        kInteger,   ///< General-purpose register or stack word (integers & pointers)
+        kSingle,    ///< Vector register holding an IEEE 754 single
+        kDouble     ///< Vector register holding an IEEE 754 double
+    };
+
+    /// @brief Where a parameter gets its native value from.
+    enum class ParamKind : char
+    {
+        kValue,     ///< Scalar value of a q atom (or of each list item, in "each" mode)
+        kPointer,   ///< Pointer to the items of a q list, passed without any copy
+        kCount,     ///< Item count of a pointer argument, not passed from q
+        kOutput     ///< Pointer to the items of a list allocated for the function to fill in
+    };
+
+    /// @brief No parameter referred to.
+    constexpr std::size_t kNoSource = static_cast<std::size_t>(-1);
+
+    /// @brief One item (result or parameter) in a foreign function's signature.
+    struct Parameter
+    {
+        char code;              ///< Type code, as in @c q::TypeCode
+        q::TypeId type_id;      ///< q type of the corresponding atom
+        NativeClass native;     ///< Native value class
+        std::size_t size;       ///< Native value width in bytes
+        ParamKind kind;         ///< Where the native value comes from
+        std::size_t source;     ///< Index of the parameter whose item count a @c kCount or @c kOutput
+                                ///< parameter takes, or @c kNoSource
+        std::size_t length;     ///< Constant item count of a @c kOutput parameter without @c source
+        std::shared_ptr<StructLayout const> layout;    ///< Struct type of a table parameter, or @c nullptr
+
+        /// @brief If the parameter's value is passed from q.
+        bool is_explicit() const noexcept
+        { return ParamKind::kValue == kind || ParamKind::kPointer == kind; }
+    };
+
+    /// @brief Parsed signature of a foreign function.
+    /// @remark Type codes are the same as those used in <code>0:</code> for CSV parsing,
+    ///     with <code>" "</code> (or an empty string) for a @c void result.
+    ///     Upper-case parameter codes (e.g. <code>"F"</code> for <code>double*</code>) take a q list
+    ///     whose items are passed in place, while <code>"#"</code> passes the item count
+    ///     (as a 64-bit integer) of the closest pointer parameter before it (or after it, if none).
+    ///     <code>">F"</code> allocates a list of <code>n</code> floats for the function to fill in via a
+    ///     <code>double*</code>, where <code>n</code> is the count of the same pointer argument as for
+    ///     <code>"#"</code>, or a constant (<code>">F16"</code>), or the count of the <code>k</code>-th
+    ///     argument from q (<code>">F@0"</code>).
+    ///     A struct layout in braces (e.g. <code>"{sym:c8;bid:f;ask:f}"</code>, see @c StructLayout) takes a
+    ///     table, passed as an array of structs, and <code>">{...}"</code> returns one as a table.
+    ///     <code>"&"</code> takes a @c Callback, passed as a C function pointer, and <code>"*"</code> a @c Handle,
+    ///     passed as its native pointer (while a <code>"*"</code> result returns a new @c Handle).
+    ///     A trailing <code>"..."</code> declares a variadic function (e.g. <code>"Cjs..."</code> for
+    ///     @c snprintf), whose variadic arguments are taken from q as one last general list, while
+    ///     <code>"."</code> followed by type codes is the signature of a single call shape (e.g.
+    ///     <code>"Cjs.jf"</code>), whose arguments are passed after the default argument promotions
+    ///     (hence no <code>"e"</code>, nor <code>"#"</code> or <code>">"</code>, among them).
+    class Signature
+    {
+    public:
+        /// @throw q::K_error If any of the type codes is unknown or unsupported.
+        q_ffi_API Signature(std::string const& resType, std::string const& parTypes);
+
+        Parameter const& result() const noexcept
+        { return result_; }
+
+        /// @brief All native parameters, including implicit ones.
+        std::vector<Parameter> const& parameters() const noexcept
+        { return params_; }
+
+        /// @brief Number of arguments expected from q.
+        std::size_t rank() const noexcept
+        { return rank_; }
+
+        /// @brief If the function takes variadic arguments (whether declared by <code>"..."</code> or
+        ///     <code>"."</code>).
+        bool is_variadic() const noexcept
+        { return kNoSource != variadic_; }
+
+        /// @brief If the variadic arguments are left open (<code>"..."</code>), to be given as a list.
+        bool is_open() const noexcept
+        { return open_; }
+
+        /// @brief Number of fixed (non-variadic) native parameters.
+        std::size_t fixed() const noexcept
+        { return is_variadic() ? variadic_ : params_.size(); }
+
+        /// @brief Signature of the call shape of an open variadic signature with variadic arguments
+        ///     of types @c tail (e.g. <code>i(s.jf)</code> for <code>i(s...)</code> and <code>"jf"</code>).
+        /// @throw q::K_error If the signature is not open, or @c tail is not a valid variadic tail.
+        q_ffi_API Signature with_tail(std::string const& tail) const;
+
+        /// @brief Canonical textual form of the signature, e.g. <code>f(fj)</code>
+        q_ffi_API std::string to_str() const;
+
+        /// @brief Textual form of the native function type, as given by @c signature_v:
+        ///     temporal types are replaced by their underlying integer or float, counts by <code>j</code>,
+        ///     outputs by pointers, and struct pointers by <code>*</code> (e.g. <code>f(Fj)</code> for
+        ///     <code>f(F#)</code>, <code>i(IF)</code> for <code>d(D>Z)</code>), and variadic arguments by
+        ///     <code>...</code> (<code>i(s...)</code> for both <code>i(s...)</code> and <code>i(s.jf)</code>).
+        q_ffi_API std::string native_str() const;
+
+    private:
+        Parameter result_;
+        std::vector<Parameter> params_;
+        std::size_t rank_;
+        std::string codes_;
+        /// @brief Index of the first variadic parameter, or @c kNoSource.
+        std::size_t variadic_;
+        bool open_;
+    };
+
+}//namespace q_ffi
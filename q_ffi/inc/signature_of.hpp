@@ -0,0 +1,106 @@
+#pragma once
+
+#include <type_traits>
+#include "export_fn.hpp"
+
+namespace q_ffi
+{
+    namespace details
+    {
+        constexpr char code_of(q::TypeId tid) noexcept
+        {
+            switch (tid)
+            {
+            case q::kBoolean: return 'b';
+            case q::kByte: return 'x';
+            case q::kShort: return 'h';
+            case q::kInt: return 'i';
+            case q::kLong: return 'j';
+            case q::kReal: return 'e';
+            case q::kFloat: return 'f';
+            case q::kChar: return 'c';
+            case q::kSymbol: return 's';
+            default: return '\0';
+            }
+        }
+
+        constexpr char to_upper(char code) noexcept
+        { return 'a' <= code && code <= 'z' ? static_cast<char>(code - 'a' + 'A') : code; }
+
+        /// @brief Type code of the native type @c T, as in @c Signature::native_str.
+        template<typename T>
+        constexpr char native_code() noexcept
+        {
+            using Value = std::remove_cv_t<T>;
+            if constexpr (std::is_void_v<Value>) {
+                return ' ';
+            }
+            else if constexpr (q::kNil != ktype_v<Value>) {
+                return code_of(ktype_v<Value>);
+            }
+            else if constexpr (std::is_pointer_v<Value>) {
+                using Item = std::remove_cv_t<std::remove_pointer_t<Value>>;
+                if constexpr (std::is_function_v<Item>)
+                    return '&';
+                else if constexpr (q::kNil != ktype_v<Item>)
+                    return to_upper(code_of(ktype_v<Item>));
+                else
+                    return '*';
+            }
+            else {
+                static_assert(!std::is_same_v<Value, Value>, "unsupported native type");
+                return '\0';
+            }
+        }
+
+        template<typename Fn>
+        struct SignatureOf;
+
+        template<typename Res, typename... Params>
+        struct SignatureOf<Res(Params...)>
+        {
+            static constexpr char value[] = { native_code<Res>(), '(', native_code<Params>()..., ')', '\0' };
+        };
+
+        template<typename Res, typename... Params>
+        struct SignatureOf<Res(Params...) noexcept> : SignatureOf<Res(Params...)>
+        {};
+
+        template<typename Res, typename... Params>
+        struct SignatureOf<Res(Params..., ...)>
+        {
+            static constexpr char value[] = {
+                native_code<Res>(), '(', native_code<Params>()..., '.', '.', '.', ')', '\0' };
+        };
+
+        template<typename Res, typename... Params>
+        struct SignatureOf<Res(Params..., ...) noexcept> : SignatureOf<Res(Params..., ...)>
+        {};
+
+        template<typename Fn>
+        struct SignatureOf<Fn*> : SignatureOf<Fn>
+        {};
+
+    }//namespace q_ffi::details
+
+    /// @brief Signature of the C/C++ function type @c Fn, in the form of @c Signature::native_str,
+    ///     computed at compile time (e.g. <code>"f(jF)"</code> for <code>double(int64_t, double const*)</code>).
+    /// @remark Type codes are those of @c ktype_v, upper-cased for pointers to such types, with
+    ///     <code>"&"</code> for function pointers and <code>"*"</code> for any other pointer, and
+    ///     <code>"..."</code> for variadic arguments.
+    template<typename Fn>
+    constexpr char const* signature_v = details::SignatureOf<Fn>::value;
+
+}//namespace q_ffi
+
+/// @brief Prefix of the symbols through which a library advertises the signatures of its functions.
+#define q_ffi_SIGNATURE_PREFIX "q_ffi_signature_"
+
+/// @brief Advertise the signature of the C function @c fn exported by a library, to be checked against
+///     the signature declared when binding it (through <code>.ffi.load</code> or <code>.ffi.bind</code>).
+/// @code{.cpp}
+///     extern "C" double scale(std::int64_t n, double const* x);
+///     q_ffi_SIGNATURE(scale)
+/// @endcode
+#define q_ffi_SIGNATURE(fn) \
+    q_ffi_EXTERN q_ffi_EXPORT_API char const* const q_ffi_signature_##fn = q_ffi::signature_v<decltype(fn)>;
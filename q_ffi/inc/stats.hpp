@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "q_ffi.h"
+#include <k_compat.h>
+
+namespace q_ffi
+{
+    /// @brief Call statistics of a binding.
+    /// @remark Counters are sharded per thread (each thread updating its own cache line with relaxed atomics),
+    ///     and only summed up on read. While collection is switched off, the only cost of a call is
+    ///     checking the switch. All live instances are listed by @c table.
+    class CallStats
+    {
+    public:
+        /// @brief Counters summed over all threads.
+        struct Totals
+        {
+            std::uint64_t calls;
+            std::uint64_t nanos;
+            std::uint64_t max_nanos;
+            std::uint64_t bytes_in;
+            std::uint64_t bytes_out;
+            std::uint64_t errors;
+        };
+
+        /// @param name Name listed in @c table.
+        /// @param listed If the instance is listed in @c table at all.
+        q_ffi_API explicit CallStats(std::string name, bool listed = true);
+
+        q_ffi_API ~CallStats();
+
+        CallStats(CallStats const&) = delete;
+        CallStats& operator=(CallStats const&) = delete;
+
+        std::string const& name() const noexcept
+        { return name_; }
+
+        /// @brief If statistics are being collected (for all bindings).
+        static bool enabled() noexcept
+        { return enabled_.load(std::memory_order_relaxed); }
+
+        /// @brief Switch collection on or off.
+        /// @return If collection was on.
+        q_ffi_API static bool enable(bool on) noexcept;
+
+        /// @brief Time the call @c fn over @c n arguments, and count its payload and errors.
+        template<typename Fn>
+        ::K observe(::K const* args, std::size_t n, Fn&& fn);
+
+        q_ffi_API void record(std::uint64_t nanos, std::uint64_t bytes_in, std::uint64_t bytes_out) noexcept;
+
+        q_ffi_API void fail() noexcept;
+
+        q_ffi_API Totals totals() const noexcept;
+
+        /// @brief Zero all counters.
+        q_ffi_API void reset() noexcept;
+
+        /// @brief Zero the counters of all live instances.
+        q_ffi_API static void reset_all() noexcept;
+
+        /// @brief Size of the data held by a q object (items of lists, columns of tables, etc.).
+        q_ffi_API static std::uint64_t payload(::K k) noexcept;
+
+        /// @brief A table with one row per live instance, in order of creation:
+        ///     <code>name calls nanos maxNanos bytesIn bytesOut errors</code>.
+        q_ffi_API static ::K table();
+
+    private:
+        static constexpr std::size_t kShards = 16;
+
+        struct alignas(64) Shard
+        {
+            std::atomic<std::uint64_t> calls;
+            std::atomic<std::uint64_t> nanos;
+            std::atomic<std::uint64_t> max_nanos;
+            std::atomic<std::uint64_t> bytes_in;
+            std::atomic<std::uint64_t> bytes_out;
+            std::atomic<std::uint64_t> errors;
+        };
+
+        /// @brief Shard of the calling thread.
+        Shard& local() noexcept;
+
+        static std::atomic<bool> enabled_;
+
+        std::string name_;
+        Shard shards_[kShards];
+    };
+
+    template<typename Fn>
+    ::K CallStats::observe(::K const* args, std::size_t n, Fn&& fn)
+    {
+        using Clock = std::chrono::steady_clock;
+        auto const start = Clock::now();
+        ::K result;
+        try {
+            result = fn();
+        }
+        catch (...) {
+            fail();
+            throw;
+        }
+        auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+
+        std::uint64_t in = 0;
+        for (std::size_t i = 0; i < n; ++i)
+            in += payload(args[i]);
+        record(static_cast<std::uint64_t>(elapsed.count()), in, payload(result));
+        return result;
+    }
+
+}//namespace q_ffi
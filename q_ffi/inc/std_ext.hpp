@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <type_traits>
+#if __cplusplus >= 202002L
+#   include <span>
+#endif
 
 /// @ref https://stackoverflow.com/questions/1903954/is-there-a-standard-sign-function-signum-sgn-in-c-c
 namespace std_ext
@@ -23,4 +27,61 @@ namespace std_ext
         return signum(x, std::is_signed<Num>());
     }
 
+#if __cplusplus >= 202002L
+    using std::span;
+#else
+    /// @brief Stand-in for C++20's @c std::span (with dynamic extent only): a non-owning view over
+    ///     contiguous items.
+    template<typename T>
+    class span
+    {
+    public:
+        using element_type = T;
+        using value_type = std::remove_cv_t<T>;
+        using size_type = std::size_t;
+        using pointer = T*;
+        using reference = T&;
+        using iterator = T*;
+
+        constexpr span() noexcept
+            : data_{ nullptr }, size_{ 0 }
+        {}
+
+        constexpr span(pointer data, size_type size) noexcept
+            : data_{ data }, size_{ size }
+        {}
+
+        template<typename Other,
+            typename = std::enable_if_t<std::is_convertible<Other(*)[], T(*)[]>::value>>
+        constexpr span(span<Other> const& other) noexcept
+            : data_{ other.data() }, size_{ other.size() }
+        {}
+
+        constexpr pointer data() const noexcept
+        { return data_; }
+
+        constexpr size_type size() const noexcept
+        { return size_; }
+
+        constexpr bool empty() const noexcept
+        { return 0 == size_; }
+
+        constexpr iterator begin() const noexcept
+        { return data_; }
+
+        constexpr iterator end() const noexcept
+        { return data_ + size_; }
+
+        constexpr reference operator[](size_type i) const noexcept
+        { return data_[i]; }
+
+        constexpr span subspan(size_type offset, size_type count) const noexcept
+        { return span{ data_ + offset, count }; }
+
+    private:
+        pointer data_;
+        size_type size_;
+    };
+#endif
+
 }//namespace std_ext
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include "q_ffi.h"
+#include <k_compat.h>
+#include "invoker.hpp"
+
+namespace q_ffi
+{
+    /// @brief Small direct-mapped cache from native strings to the symbols they were interned into.
+    /// @remark Foreign functions returning symbols tend to return strings from a fixed set (e.g. status codes),
+    ///     often at the same addresses, so that most results are found here by pointer and confirmed by
+    ///     comparing contents, without hashing into or locking q's symbol table through @c ss.
+    ///     To be used from the main thread only.
+    class SymbolCache
+    {
+    public:
+        SymbolCache() noexcept;
+
+        SymbolCache(SymbolCache const&) = delete;
+        SymbolCache& operator=(SymbolCache const&) = delete;
+
+        /// @brief Interned symbol of @c s (or of the null symbol for @c nullptr).
+        q_ffi_API ::S intern(char const* s) noexcept;
+
+        /// @brief Intern, in place, the items of a symbol list still holding native strings.
+        q_ffi_API void intern(::K list) noexcept;
+
+        /// @brief New symbol atom of @c s.
+        q_ffi_API ::K atom(char const* s) noexcept;
+
+        /// @brief Number of strings found in the cache.
+        std::size_t hits() const noexcept
+        { return hits_; }
+
+        /// @brief Number of strings interned through @c ss.
+        std::size_t misses() const noexcept
+        { return misses_; }
+
+        /// @brief @c Storer writing native strings into a symbol list as they are, for @c intern to follow.
+        /// @remark Unlike interning, this is safe on worker threads.
+        q_ffi_API static void store(::K list, std::size_t i, Slot res) noexcept;
+
+    private:
+        static constexpr std::size_t kSize = 64;
+
+        struct Entry
+        {
+            char const* raw;
+            ::S sym;
+        };
+
+        Entry entries_[kSize];
+        std::size_t hits_;
+        std::size_t misses_;
+    };
+
+}//namespace q_ffi
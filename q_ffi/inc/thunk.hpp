@@ -0,0 +1,35 @@
+#pragma once
+
+#include "q_ffi.h"
+#include <k_compat.h>
+#include "signature.hpp"
+#include "invoker.hpp"
+
+namespace q_ffi
+{
+    /// @brief Call thunk specialized at compile time for one exact scalar signature.
+    /// @return @c false (without calling @c fn) if any of @c args is not an atom of the exact type,
+    ///     in which case the generic marshaling path should be taken instead.
+    /// @remark A symbol result is left as the native string returned, to be interned by the caller.
+    using Thunk = bool (*)(FunctionPtr fn, ::K const* args, ::K& result);
+
+    /// @brief Call thunk looping natively over list arguments ("each" mode) for one exact scalar signature.
+    /// @param args Atoms (broadcast) or lists of the exact parameter types, as checked by the caller.
+    /// @param result Preallocated list receiving items <code>[begin, end)</code>, or @c nullptr for a @c void result.
+    /// @remark No K object is created or released, so that partitions may run on worker threads.
+    ///     Symbol results are stored as the native strings returned, to be interned by the caller.
+    using EachThunk = void (*)(FunctionPtr fn, ::K const* args, ::K result, std::size_t begin, std::size_t end);
+
+    /// @brief Max number of parameters for which thunks exist for all type combinations.
+    ///     Beyond that (and up to @c kMaxCallArgs), only thunks with uniform parameter types exist.
+    constexpr std::size_t kMaxMixedThunkArgs = 3;
+
+    /// @brief Pick the thunk matching @c sig (to be done once, at load time).
+    /// @return @c nullptr if @c sig is not covered by any thunk.
+    ///     Covered signatures are built only from <code>ijefs</code> (plus <code>" "</code> result).
+    q_ffi_API Thunk select_thunk(Signature const& sig) noexcept;
+
+    /// @brief Pick the "each" mode thunk matching @c sig; same coverage as @c select_thunk.
+    q_ffi_API EachThunk select_each_thunk(Signature const& sig) noexcept;
+
+}//namespace q_ffi
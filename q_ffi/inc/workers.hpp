@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "q_ffi.h"
+
+namespace q_ffi
+{
+    /// @brief Pool of worker threads for partitioned execution of thread-safe foreign functions.
+    /// @remark Tasks run on worker threads must never create or release K objects,
+    ///     as q's memory manager is only to be used from the main thread.
+    class WorkerPool
+    {
+    public:
+        /// @brief Partition task, processing items <code>[begin, end)</code>.
+        using Task = std::function<void(std::size_t begin, std::size_t end)>;
+
+        q_ffi_API static WorkerPool& instance();
+
+        ~WorkerPool();
+
+        WorkerPool(WorkerPool const&) = delete;
+        WorkerPool& operator=(WorkerPool const&) = delete;
+
+        /// @brief Number of worker threads, not counting the calling thread.
+        q_ffi_API std::size_t size() const;
+
+        /// @brief Replace all worker threads with @c workers new ones.
+        q_ffi_API void resize(std::size_t workers);
+
+        /// @brief Split <code>[0, n)</code> into partitions of at least @c grain items, and process them
+        ///     on both the calling thread and the workers, returning once all are done.
+        /// @throw The first exception thrown by any of the partitions, if any.
+        q_ffi_API void run(std::size_t n, std::size_t grain, Task const& task);
+
+    private:
+        explicit WorkerPool(std::size_t workers);
+
+        void start(std::size_t workers);
+        void stop();
+        void loop();
+
+        /// @brief Claim and process partitions until none is left (with @c lock held on entry & exit).
+        void work(std::unique_lock<std::mutex>& lock);
+
+        std::mutex run_;
+        mutable std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        std::vector<std::thread> threads_;
+        bool stopping_;
+
+        Task const* task_;
+        std::size_t total_;
+        std::size_t chunk_;
+        std::size_t chunks_;
+        std::size_t next_;
+        std::size_t remaining_;
+        std::exception_ptr error_;
+    };
+
+}//namespace q_ffi
@@ -0,0 +1,76 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+using q_ffi::Arena;
+using q_ffi::Scratch;
+
+Arena::Arena(std::size_t block_size)
+    : block_size_{ std::max<std::size_t>(block_size, 64) }, blocks_{}, current_{ 0 }
+{}
+
+Arena& Arena::local() noexcept
+{
+    thread_local Arena arena;
+    return arena;
+}
+
+void* Arena::allocate(std::size_t size, std::size_t alignment)
+{
+    assert(0 < alignment && 0 == (alignment & (alignment - 1)));
+    auto const fit = [size, alignment](Block& block) -> void* {
+        auto const base = reinterpret_cast<std::uintptr_t>(block.data.get());
+        auto const begin = (base + block.used + alignment - 1) & ~(alignment - 1);
+        if (block.size < begin - base + size)
+            return nullptr;
+        block.used = begin - base + size;
+        return reinterpret_cast<void*>(begin);
+    };
+
+    for (auto i = current_; i < blocks_.size(); ++i) {
+        if (i != current_)
+            blocks_[i].used = 0;
+        if (auto const p = fit(blocks_[i])) {
+            current_ = i;
+            std::memset(p, 0, size);
+            return p;
+        }
+    }
+
+    auto block_size = blocks_.empty() ? block_size_ : blocks_.back().size * 2;
+    while (block_size < size + alignment)
+        block_size *= 2;
+    blocks_.push_back(Block{ std::make_unique<char[]>(block_size), block_size, 0 });
+    current_ = blocks_.size() - 1;
+    auto const p = fit(blocks_.back());
+    assert(nullptr != p);
+    std::memset(p, 0, size);
+    return p;
+}
+
+void Arena::rewind(Mark const& to) noexcept
+{
+    if (blocks_.empty())
+        return;
+    current_ = to.block;
+    blocks_[current_].used = to.used;
+    while (current_ + 1 < blocks_.size() && kMaxRetained < blocks_.back().size)
+        blocks_.pop_back();
+}
+
+std::size_t Arena::capacity() const noexcept
+{
+    std::size_t total = 0;
+    for (auto const& block : blocks_)
+        total += block.size;
+    return total;
+}
+
+char const* Scratch::terminate(char const* s, std::size_t n)
+{
+    auto const copy = static_cast<char*>(allocate(n + 1, 1));
+    std::memcpy(copy, s, n);
+    return copy;
+}
@@ -0,0 +1,147 @@
+#include "async.hpp"
+#include "ktype_traits.hpp"
+#include "callback.hpp"
+#include <optional>
+#include <dlfcn.h>
+#include <unistd.h>
+#ifdef __linux__
+#   include <sys/eventfd.h>
+#endif
+
+using q_ffi::AsyncQueue;
+
+AsyncQueue& AsyncQueue::instance()
+{
+    static AsyncQueue queue;
+    return queue;
+}
+
+AsyncQueue::AsyncQueue()
+    : mutex_{}, wake_{}, done_{}, queued_{}, completed_{}, worker_{}, stopping_{ false },
+    fd_{ -1 }, registered_{ false }, pending_{ 0 }
+{}
+
+AsyncQueue::~AsyncQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock{ mutex_ };
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable())
+        worker_.join();
+
+    // q may be gone already: leak whatever was not delivered
+    for (auto* entries : { &queued_, &completed_ }) {
+        for (auto& entry : *entries) {
+            static_cast<void>(entry.job.release());
+            static_cast<void>(entry.callback.release());
+        }
+    }
+    if (0 <= fd_)
+        ::close(fd_);
+}
+
+void AsyncQueue::start()
+{
+    if (0 <= fd_)
+        return;
+#ifdef __linux__
+    fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd_ < 0)
+        throw q::K_error("eventfd");
+
+    using Sd1 = ::K (*)(::I, ::K (*)(::I));
+    auto const sd1 = reinterpret_cast<Sd1>(reinterpret_cast<std::uintptr_t>(::dlsym(RTLD_DEFAULT, "sd1")));
+    if (nullptr != sd1) {
+        sd1(fd_, &AsyncQueue::on_event);
+        registered_ = true;
+    }
+    worker_ = std::thread{ &AsyncQueue::work, this };
+#else
+    throw q::K_error("nyi");
+#endif
+}
+
+void AsyncQueue::submit(std::unique_ptr<Job> job, ::K callback)
+{
+    start();
+    q::K_ptr cb{ q::kNil == q::type(callback) ? q::Nil : ::r1(callback) };
+    {
+        std::lock_guard<std::mutex> lock{ mutex_ };
+        queued_.push_back(Entry{ std::move(job), std::move(cb) });
+    }
+    ++pending_;
+    wake_.notify_one();
+}
+
+std::size_t AsyncQueue::drain(bool wait)
+{
+    std::size_t delivered = 0;
+    std::optional<std::string> error;
+    while (0 < pending_) {
+        std::deque<Entry> batch;
+        {
+            std::unique_lock<std::mutex> lock{ mutex_ };
+            if (wait)
+                done_.wait(lock, [this] { return !completed_.empty(); });
+            batch.swap(completed_);
+        }
+        for (auto& entry : batch) {
+            --pending_;
+            ++delivered;
+            try {
+                q::K_ptr result{ entry.job->finish() };
+                if (nullptr != entry.callback) {
+                    q::K_ptr args{ ::knk(1, result.release()) };
+                    q::K_ptr r{ evaluate(entry.callback.get(), args.get()) };
+                }
+            }
+            catch (q::K_error const& ex) {
+                if (!error)
+                    error = ex.what();
+            }
+        }
+        if (!wait)
+            break;
+    }
+    if (error)
+        throw q::K_error(*error);
+    return delivered;
+}
+
+void AsyncQueue::work()
+{
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    for (;;) {
+        wake_.wait(lock, [this] { return stopping_ || !queued_.empty(); });
+        if (stopping_)
+            return;
+        auto entry = std::move(queued_.front());
+        queued_.pop_front();
+
+        lock.unlock();
+        entry.job->run();
+        lock.lock();
+
+        completed_.push_back(std::move(entry));
+        done_.notify_all();
+        std::uint64_t const one = 1;
+        auto const written = ::write(fd_, &one, sizeof(one));
+        static_cast<void>(written);     // the counter only saturates if nobody is listening
+    }
+}
+
+::K AsyncQueue::on_event(::I fd)
+{
+    std::uint64_t count = 0;
+    auto const n = ::read(fd, &count, sizeof(count));
+    static_cast<void>(n);
+    try {
+        instance().drain();
+        return q::Nil;
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
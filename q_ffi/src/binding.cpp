@@ -0,0 +1,557 @@
+#include "binding.hpp"
+#include "ktype_traits.hpp"
+#include "kpointer.hpp"
+#include "workers.hpp"
+#include "callback.hpp"
+#include "async.hpp"
+#include "handle.hpp"
+#include "marshal.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+namespace q_ffi::details
+{
+    /// @brief Native argument buffer, on the stack unless there are too many parameters.
+    class SlotBuffer
+    {
+    public:
+        explicit SlotBuffer(std::size_t n)
+            : local_{}, heap_{ kLocal < n ? new q_ffi::Slot[n] : nullptr }
+        {}
+
+        q_ffi::Slot* get() noexcept
+        { return nullptr == heap_ ? local_ : heap_.get(); }
+
+    private:
+        static constexpr std::size_t kLocal = 16;
+        q_ffi::Slot local_[kLocal];
+        std::unique_ptr<q_ffi::Slot[]> heap_;
+    };
+
+}//namespace q_ffi::details
+
+namespace
+{
+    using q_ffi::details::SlotBuffer;
+
+    template<typename T>
+    q_ffi::Slot to_slot(T* p) noexcept
+    { return static_cast<q_ffi::Slot>(reinterpret_cast<std::uintptr_t>(p)); }
+
+    q_ffi::FunctionPtr not_null(q_ffi::FunctionPtr fn)
+    {
+        if (nullptr == fn)
+            throw q::K_error("null function");
+        return fn;
+    }
+
+    /// @brief Item count of a list or native buffer, or row count of a table (none for <code>::</code>,
+    ///     as passed for a null pointer).
+    std::size_t item_count(::K k)
+    {
+        switch (q::type(k))
+        {
+        case q::kNil:
+            return 0;
+        case q::kTable:
+            return q_ffi::StructLayout::rows(k);
+        case q::kForeign:
+            return q_ffi::Handle::from_q(k).count();
+        default:
+            return q::count(k);
+        }
+    }
+
+    /// @brief Type code a variadic argument is passed as, after the default argument promotions
+    ///     (integers narrower than @c int are already widened in their slots).
+    char variadic_code(::K arg)
+    {
+        auto const t = q::type(arg);
+        if (-q::kReal == t)
+            return 'f';
+        if (q::kChar == t)
+            return 's';     // NUL-terminated string
+        auto const tid = static_cast<q::TypeId>(0 > t ? -t : t);
+        if (q::kBoolean > tid || q::kTime < tid || q::kGUID == tid)
+            throw q::K_error("type");
+        auto const code = q::TypeCode.at(tid);
+        return 0 > t ? code : static_cast<char>(std::toupper(static_cast<unsigned char>(code)));
+    }
+
+    /// @brief Item @c i of the simple list @c list, as an atom.
+    ::K item_atom(::K list, std::size_t i)
+    {
+        auto const tid = static_cast<q::TypeId>(q::type(list));
+        auto const width = q_ffi::item_size(tid);
+        auto const atom = ::ka(-tid);
+        std::memcpy(&atom->g, kG(list) + i * width, width);
+        return atom;
+    }
+
+}//namespace /*anonymous*/
+
+q_ffi::Binding::Binding(FunctionPtr fn, Signature signature, std::shared_ptr<void> library,
+    BindingOptions const& options)
+    : library_{ std::move(library) }, fn_{ not_null(fn) }, resolver_{}, symbol_{}, options_{ options },
+    proto_{ Prototype::intern(std::move(signature), options_.name) }, symbols_{}, stats_{ options_.name },
+    shapes_{}
+{}
+
+q_ffi::Binding::Binding(std::shared_ptr<Library> library, std::string symbol, Signature signature,
+    BindingOptions const& options)
+    : library_{ library }, fn_{ nullptr }, resolver_{ std::move(library) }, symbol_{ std::move(symbol) },
+    options_{ options }, proto_{ Prototype::intern(std::move(signature), options_.name) },
+    symbols_{}, stats_{ options_.name }, shapes_{}
+{
+    if (nullptr == resolver_)
+        throw q::K_error("null library");
+}
+
+q_ffi::Binding::Binding(Binding const& parent, Signature shape)
+    : library_{ parent.library_ }, fn_{ not_null(parent.fn_) }, resolver_{}, symbol_{}, options_{ parent.options_ },
+    proto_{ Prototype::intern(std::move(shape), options_.name) }, symbols_{},
+    stats_{ options_.name, false }, shapes_{}
+{}
+
+q_ffi::Binding::~Binding()
+{
+    Prototype::release(*proto_, options_.name);
+}
+
+::K q_ffi::Binding::operator()(::K const* args) const
+{
+    resolve();
+    if (CallStats::enabled())
+        return stats_.observe(args, rank(), [&] { return call(args); });
+    return call(args);
+}
+
+::K q_ffi::Binding::apply(::K args) const
+{
+    resolve();
+    if (CallStats::enabled())
+        return stats_.observe(&args, 1, [&] { return call_list(args); });
+    return call_list(args);
+}
+
+::K q_ffi::Binding::apply_rows(::K table) const
+{
+    resolve();
+    if (CallStats::enabled())
+        return stats_.observe(&table, 1, [&] { return call_rows(table); });
+    return call_rows(table);
+}
+
+::K q_ffi::Binding::call(::K const* args) const
+{
+    if (proto_->signature.is_open())
+        return call_variadic(args);
+
+    ::K result;
+    if (nullptr != proto_->thunk && proto_->thunk(fn_, args, result)) {
+        if (q::kSymbol == proto_->signature.result().type_id) {
+            auto& sym = q::TypeTraits<q::kSymbol>::value(result);
+            sym = symbols_.intern(sym);
+        }
+        return result;
+    }
+
+    auto const n = each_count(args);
+    if (npos == n)
+        return invoke(args, nullptr);
+    if (!proto_->outputs.empty() || !proto_->structs.empty())
+        throw q::K_error("nyi");
+    return invoke_each(args, n);
+}
+
+::K q_ffi::Binding::call_variadic(::K const* args) const
+{
+    auto const fixed = rank() - 1;
+    auto const rest = args[fixed];
+    auto const t = q::type(rest);
+    if (q::kMixed != t && (q::kBoolean > t || q::kTime < t || q::kGUID == t))
+        throw q::K_error("type");
+    auto const n = q::count(rest);
+
+    // q collapses homogeneous lists: take the items of a simple list as atoms
+    std::vector<q::K_ptr> promoted;
+    std::vector<::K> atoms;
+    if (q::kMixed != t) {
+        atoms.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            promoted.emplace_back(item_atom(rest, i));
+            atoms.push_back(promoted.back().get());
+        }
+    }
+    auto const items = q::kMixed == t ? q::TypeTraits<q::kMixed>::index(rest) : atoms.data();
+
+    std::vector<::K> all(args, args + fixed);
+    std::string tail;
+    all.reserve(fixed + n);
+    tail.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        auto const code = variadic_code(items[i]);
+        if (-q::kReal == q::type(items[i])) {
+            promoted.emplace_back(q::TypeTraits<q::kFloat>::atom(q::TypeTraits<q::kReal>::value(items[i])));
+            all.push_back(promoted.back().get());
+        }
+        else {
+            all.push_back(items[i]);
+        }
+        tail += code;
+    }
+
+    auto& shape = shapes_[tail];
+    if (nullptr == shape)
+        shape.reset(new Binding{ *this, proto_->signature.with_tail(tail) });
+    return shape->call(all.data());
+}
+
+::K q_ffi::Binding::call_list(::K args) const
+{
+    auto const n = rank();
+    if (0 == n)
+        return call(nullptr);
+    if (1 == n && 0 > q::type(args))
+        return call(&args);
+    if (q::kNil == q::type(args) || 0 > q::type(args) || n != q::count(args))
+        throw q::K_error("rank");
+    if (q::kMixed == q::type(args))
+        return call(q::TypeTraits<q::kMixed>::index(args));
+    if (proto_->signature.is_open())
+        throw q::K_error("type");   // variadic arguments come as a list, not as an atom
+    for (auto const& par : proto_->signature.parameters()) {
+        if (ParamKind::kPointer == par.kind || ParamKind::kCount == par.kind || q::kForeign == par.type_id)
+            throw q::K_error("type");   // pointers cannot be items of a simple list
+    }
+    return invoke(nullptr, args);
+}
+
+::K q_ffi::Binding::call_rows(::K table) const
+{
+    if (q::kTable != q::type(table))
+        throw q::K_error("type");
+    if (proto_->signature.is_open())
+        throw q::K_error("nyi");
+    auto const columns = kK(table->k)[1];
+    if (rank() != static_cast<std::size_t>(q::count(columns)))
+        throw q::K_error("rank");
+
+    auto const& params = proto_->signature.parameters();
+    auto const args = q::TypeTraits<q::kMixed>::index(columns);
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        if (ParamKind::kValue != params[i].kind || q::kForeign == params[i].type_id
+            || params[i].type_id != q::type(args[proto_->sources[i]]))
+            throw q::K_error("type");
+    }
+    return invoke_each(args, StructLayout::rows(table));
+}
+
+/// @brief Native arguments of a call, along with everything they point to.
+struct q_ffi::Binding::Frame
+{
+    explicit Frame(std::size_t n, Arena& arena = Arena::local())
+        : buffer{ n }, scratch{ arena }, outputs{}, counts{}, result{ 0 }
+    {}
+
+    Slot* slots() noexcept
+    { return buffer.get(); }
+
+    SlotBuffer buffer;
+    Scratch scratch;
+    std::vector<q::K_ptr> outputs;
+    std::vector<std::size_t> counts;
+    Slot result;
+};
+
+/// @brief A call marshaled on the main thread, run on the async thread, and completed on the main thread.
+class q_ffi::Binding::AsyncCall final : public AsyncQueue::Job
+{
+public:
+    AsyncCall(::K binding, ::K args)
+        : owner_{ ::r1(binding) }, args_{ nullptr == args ? q::Nil : ::r1(args) }, atom_{ args_.get() },
+        binding_{ from_q(binding) }, arena_{}, frame_{ binding_.proto_->marshalers.size(), arena_ }, nanos_{ -1 }
+    {
+        auto const list = args_.get();
+        if (0 == binding_.rank())
+            binding_.prepare(frame_, nullptr, nullptr);
+        else if (1 == binding_.rank() && 0 > q::type(list))
+            binding_.prepare(frame_, &atom_, nullptr);
+        else if (q::kMixed == q::type(list))
+            binding_.prepare(frame_, q::TypeTraits<q::kMixed>::index(list), nullptr);
+        else
+            binding_.prepare(frame_, nullptr, list);
+    }
+
+    void run() noexcept override
+    {
+        if (!CallStats::enabled()) {
+            frame_.result = binding_.proto_->invoker(binding_.fn_, frame_.slots());
+            return;
+        }
+        using Clock = std::chrono::steady_clock;
+        auto const start = Clock::now();
+        frame_.result = binding_.proto_->invoker(binding_.fn_, frame_.slots());
+        nanos_ = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    ::K finish() override
+    {
+        if (0 > nanos_)
+            return binding_.complete(frame_);
+        q::K_ptr result;
+        try {
+            result.reset(binding_.complete(frame_));
+        }
+        catch (q::K_error const&) {
+            binding_.stats_.fail();
+            throw;
+        }
+        binding_.stats_.record(static_cast<std::uint64_t>(nanos_),
+            CallStats::payload(args_.get()), CallStats::payload(result.get()));
+        return result.release();
+    }
+
+private:
+    q::K_ptr owner_;
+    q::K_ptr args_;
+    ::K atom_;
+    Binding const& binding_;
+    /// @brief Temporaries outliving other calls on the main thread.
+    Arena arena_;
+    Frame frame_;
+    /// @brief Duration of the native call, if timed.
+    std::int64_t nanos_;
+};
+
+::K q_ffi::Binding::invoke(::K const* args, ::K list) const
+{
+    Frame frame{ proto_->marshalers.size() };
+    prepare(frame, args, list);
+    frame.result = proto_->invoker(fn_, frame.slots());
+    settle_callbacks(args);
+    return complete(frame);
+}
+
+void q_ffi::Binding::post(::K binding, ::K args, ::K callback)
+{
+    auto const& self = from_q(binding);
+    if (self.proto_->signature.is_open())
+        throw q::K_error("nyi");
+    self.resolve();
+    auto const n = self.rank();
+    auto const t = q::type(args);
+    if (0 < n && !(1 == n && 0 > t)) {
+        if (q::kNil == t || 0 > t || n != q::count(args))
+            throw q::K_error("rank");
+        if (q::kMixed == t && npos != self.each_count(q::TypeTraits<q::kMixed>::index(args)))
+            throw q::K_error("nyi");
+        if (q::kMixed != t) {
+            for (auto const& par : self.proto_->signature.parameters()) {
+                if (ParamKind::kPointer == par.kind || ParamKind::kCount == par.kind)
+                    throw q::K_error("type");
+            }
+        }
+    }
+    if (!self.proto_->callbacks.empty())
+        throw q::K_error("nyi");    // callbacks would be evaluated off the main thread
+    AsyncQueue::instance().submit(std::make_unique<AsyncCall>(binding, args), callback);
+}
+
+void q_ffi::Binding::prepare(Frame& frame, ::K const* args, ::K list) const
+{
+    auto const& proto = *proto_;
+    auto const n = proto.marshalers.size();
+    auto const slots = frame.slots();
+    for (std::size_t i = 0; i < n; ++i) {
+        if (nullptr == proto.marshalers[i])
+            continue;
+        slots[i] = nullptr == args
+            ? proto.marshalers[i](list, proto.sources[i], frame.scratch)
+            : proto.marshalers[i](args[proto.sources[i]], 0, frame.scratch);
+    }
+    auto const& params = proto.signature.parameters();
+    for (auto const i : proto.structs) {
+        assert(nullptr != args);
+        auto const& layout = *params[i].layout;
+        auto const table = args[proto.sources[i]];
+        void* rows = nullptr;
+        if (q::kNil != q::type(table)) {
+            rows = frame.scratch.allocate(StructLayout::rows(table) * layout.size(), layout.alignment());
+            layout.pack(table, rows);
+        }
+        slots[i] = to_slot(rows);
+    }
+    if (proto.outputs.empty())
+        return;
+
+    frame.outputs.reserve(proto.outputs.size());
+    frame.counts.reserve(proto.outputs.size());
+    for (auto const i : proto.outputs) {
+        auto const& par = params[i];
+        auto const count = kNoSource == proto.sources[i] ? par.length
+            : nullptr == args ? 1u : item_count(args[proto.sources[i]]);
+        frame.counts.push_back(count);
+        if (nullptr == par.layout) {
+            frame.outputs.emplace_back(::ktn(par.type_id, static_cast<::J>(count)));
+            if (q::kSymbol == par.type_id)      // left unset items are interned as null symbols
+                std::fill_n(q::TypeTraits<q::kSymbol>::index(frame.outputs.back().get()), count, nullptr);
+            slots[i] = to_slot(kG(frame.outputs.back().get()));
+        }
+        else {
+            frame.outputs.emplace_back(nullptr);
+            slots[i] = to_slot(frame.scratch.allocate(count * par.layout->size(), par.layout->alignment()));
+        }
+    }
+}
+
+::K q_ffi::Binding::complete(Frame& frame) const
+{
+    auto const& proto = *proto_;
+    if (proto.outputs.empty())
+        return unmarshal(frame.result);
+
+    auto& outputs = frame.outputs;
+    q::K_ptr result{ unmarshal(frame.result) };
+    auto const& params = proto.signature.parameters();
+    for (std::size_t k = 0; k < proto.outputs.size(); ++k) {
+        auto const& par = params[proto.outputs[k]];
+        if (q::kSymbol == par.type_id && nullptr == par.layout)
+            symbols_.intern(outputs[k].get());
+        if (nullptr != par.layout) {
+            outputs[k].reset(par.layout->unpack(
+                reinterpret_cast<void const*>(static_cast<std::uintptr_t>(frame.slots()[proto.outputs[k]])),
+                frame.counts[k]));
+        }
+    }
+
+    auto const void_result = q::kNil == proto.signature.result().type_id;
+    if (void_result && 1 == outputs.size())
+        return outputs.front().release();
+    q::K_ptr all{ ::ktn(q::kMixed, static_cast<::J>(outputs.size() + (void_result ? 0 : 1))) };
+    auto items = q::TypeTraits<q::kMixed>::index(all.get());
+    if (!void_result)
+        *items++ = result.release();
+    for (auto& out : outputs)
+        *items++ = out.release();
+    return all.release();
+}
+
+::K q_ffi::Binding::unmarshal(Slot res) const
+{
+    if (q::kSymbol == proto_->signature.result().type_id)
+        return symbols_.atom(reinterpret_cast<char const*>(static_cast<std::uintptr_t>(res)));
+    if (q::kForeign == proto_->signature.result().type_id) {
+        return Handle::to_q(std::make_unique<Handle>(
+            reinterpret_cast<void*>(static_cast<std::uintptr_t>(res)), options_.destructor, library_));
+    }
+    return proto_->unmarshaler(res);
+}
+
+::K q_ffi::Binding::invoke_each(::K const* args, std::size_t n) const
+{
+    auto const& proto = *proto_;
+    auto const& res = proto.signature.result();
+    if (q::kForeign == res.type_id)
+        throw q::K_error("nyi");
+    q::K_ptr result{ nullptr == proto.storer ? nullptr : ::ktn(res.type_id, static_cast<::J>(n)) };
+
+    auto const exact = nullptr != proto.each_thunk && is_exact(args);
+    WorkerPool::Task const task = [&](std::size_t begin, std::size_t end) {
+        if (exact)
+            proto.each_thunk(fn_, args, result.get(), begin, end);
+        else
+            each_range(args, result.get(), begin, end);
+    };
+    // Callbacks must be evaluated on the main thread
+    if (options_.parallel && proto.callbacks.empty())
+        WorkerPool::instance().run(n, options_.grain, task);
+    else
+        task(0, n);
+    settle_callbacks(args);
+    if (q::kSymbol == res.type_id)
+        symbols_.intern(result.get());
+
+    return nullptr == proto.storer ? q::TypeTraits<q::kNil>::atom() : result.release();
+}
+
+void q_ffi::Binding::each_range(::K const* args, ::K result, std::size_t begin, std::size_t end) const
+{
+    auto const& proto = *proto_;
+    auto const m = proto.marshalers.size();
+    SlotBuffer buffer{ m };
+    auto const slots = buffer.get();
+
+    Scratch scratch;
+    for (std::size_t i = begin; i < end; ++i) {
+        scratch.clear();
+        for (std::size_t j = 0; j < m; ++j)
+            slots[j] = proto.marshalers[j](args[proto.sources[j]], i, scratch);
+        auto const r = proto.invoker(fn_, slots);
+        if (nullptr != proto.storer)
+            proto.storer(result, i, r);
+    }
+}
+
+void q_ffi::Binding::settle_callbacks(::K const* args) const
+{
+    if (proto_->callbacks.empty())
+        return;
+    for (auto const i : proto_->callbacks) {
+        auto const arg = args[proto_->sources[i]];
+        if (q::kNil != q::type(arg))
+            Callback::from_q(arg).flush();
+    }
+    Callback::check();
+}
+
+bool q_ffi::Binding::is_exact(::K const* args) const noexcept
+{
+    auto const& params = proto_->signature.parameters();
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        auto const t = q::type(args[proto_->sources[i]]);
+        if (params[i].type_id != t && -params[i].type_id != t)
+            return false;
+    }
+    return true;
+}
+
+std::size_t q_ffi::Binding::each_count(::K const* args) const
+{
+    auto const& params = proto_->signature.parameters();
+    auto n = npos;
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        if (ParamKind::kValue != params[i].kind || q::kForeign == params[i].type_id)
+            continue;       // not all parameters have an argument
+        auto const arg = args[proto_->sources[i]];
+        if (params[i].type_id != q::type(arg))
+            continue;
+        auto const len = static_cast<std::size_t>(q::count(arg));
+        if (npos != n && n != len)
+            throw q::K_error("length");
+        n = len;
+    }
+    return n;
+}
+
+::K q_ffi::Binding::to_q(std::unique_ptr<Binding> binding) noexcept
+{
+    return q::TypeTraits<q::kForeign>::atom(binding.release(), &Binding::finalize);
+}
+
+q_ffi::Binding& q_ffi::Binding::from_q(::K k)
+{
+    using Traits = q::TypeTraits<q::kForeign>;
+    if (!Traits::is_foreign(k, &Binding::finalize))
+        throw q::K_error("type");
+    return *static_cast<Binding*>(Traits::value(k));
+}
+
+::K q_ffi::Binding::finalize(::K k)
+{
+    delete static_cast<Binding*>(q::TypeTraits<q::kForeign>::value(k));
+    return q::Nil;
+}
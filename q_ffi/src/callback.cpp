@@ -0,0 +1,306 @@
+#include "callback.hpp"
+#include "ktype_traits.hpp"
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <dlfcn.h>
+
+using q_ffi::Callback;
+using q_ffi::CallPlan;
+using q_ffi::FunctionPtr;
+using q_ffi::ParamKind;
+using q_ffi::Slot;
+
+#pragma region Trampolines
+#ifdef q_ffi_SYSV_CALL
+/// @brief Preassembled trampolines, @c kTrampolineSize bytes apart. Each loads its own index into @c r11
+///     and jumps to the common part, which spills the argument registers into a frame on the stack
+///     and calls <code>Callback::dispatch</code>, before loading the result registers back from the frame.
+extern "C" char const q_ffi_trampolines[];
+
+/// @brief Called from the trampolines.
+extern "C" void q_ffi_callback_dispatch(std::size_t index, Slot* frame, Slot const* stack) noexcept
+{
+    Callback::dispatch(index, frame, stack);
+}
+
+namespace
+{
+    constexpr std::size_t kTrampolineSize = 16;
+}
+
+static_assert(q_ffi::kMaxCallbacks == 128, "trampoline count hard-coded below");
+static_assert(CallPlan::kIntRegs * sizeof(Slot) == 48 && CallPlan::kStackBase * sizeof(Slot) == 112,
+    "frame offsets hard-coded below");
+
+asm(R"(
+    .pushsection .text
+    .p2align 4
+    .globl  q_ffi_trampolines
+    .hidden q_ffi_trampolines
+    .type   q_ffi_trampolines, @function
+q_ffi_trampolines:
+    .set    q_ffi_trampoline_index, 0
+    .rept   128
+    .balign 16
+    movl    $q_ffi_trampoline_index, %r11d
+    jmp     q_ffi_callback_common
+    .set    q_ffi_trampoline_index, q_ffi_trampoline_index + 1
+    .endr
+    .size   q_ffi_trampolines, .-q_ffi_trampolines
+
+    .p2align 4
+    .type   q_ffi_callback_common, @function
+q_ffi_callback_common:
+    .cfi_startproc
+    pushq   %rbp
+    .cfi_def_cfa_offset 16
+    .cfi_offset %rbp, -16
+    movq    %rsp, %rbp
+    .cfi_def_cfa_register %rbp
+    subq    $112, %rsp
+    movq    %rdi, 0(%rsp)
+    movq    %rsi, 8(%rsp)
+    movq    %rdx, 16(%rsp)
+    movq    %rcx, 24(%rsp)
+    movq    %r8, 32(%rsp)
+    movq    %r9, 40(%rsp)
+    movsd   %xmm0, 48(%rsp)
+    movsd   %xmm1, 56(%rsp)
+    movsd   %xmm2, 64(%rsp)
+    movsd   %xmm3, 72(%rsp)
+    movsd   %xmm4, 80(%rsp)
+    movsd   %xmm5, 88(%rsp)
+    movsd   %xmm6, 96(%rsp)
+    movsd   %xmm7, 104(%rsp)
+
+    movl    %r11d, %edi
+    movq    %rsp, %rsi
+    leaq    16(%rbp), %rdx
+    call    q_ffi_callback_dispatch@PLT
+
+    movq    0(%rsp), %rax
+    movsd   48(%rsp), %xmm0
+    leave
+    .cfi_def_cfa %rsp, 8
+    ret
+    .cfi_endproc
+    .size   q_ffi_callback_common, .-q_ffi_callback_common
+    .popsection
+)");
+#endif
+#pragma endregion
+
+namespace
+{
+    /// @brief Callbacks holding each of the trampolines.
+    std::atomic<Callback*> trampolines[q_ffi::kMaxCallbacks];
+
+    /// @brief First error from a callback on this thread, not yet reported.
+    thread_local std::optional<std::string> pending;
+
+    void hold(char const* error)
+    {
+        if (!pending)
+            pending = error;
+    }
+
+    /// @brief First error from a callback invoked off its thread, to be reported by any thread checking.
+    std::mutex stray_lock;
+    std::optional<std::string> stray;
+
+    void hold_stray(char const* error)
+    {
+        std::lock_guard<std::mutex> const lock{ stray_lock };
+        if (!stray)
+            stray = error;
+    }
+
+    std::size_t acquire(Callback* callback)
+    {
+        for (std::size_t i = 0; i < q_ffi::kMaxCallbacks; ++i) {
+            Callback* expected = nullptr;
+            if (trampolines[i].compare_exchange_strong(expected, callback))
+                return i;
+        }
+        throw q::K_error("too many callbacks");
+    }
+
+    /// @brief Native argument @c i of a call through a trampoline.
+    Slot argument(q_ffi::Parameter const& par, std::size_t at, Slot const* frame, Slot const* stack) noexcept
+    {
+        auto arg = at < CallPlan::kStackBase ? frame[at] : stack[at - CallPlan::kStackBase];
+        if (ParamKind::kPointer == par.kind) {
+            auto const p = reinterpret_cast<void const*>(static_cast<std::uintptr_t>(arg));
+            arg = 0;
+            if (nullptr != p)
+                std::memcpy(&arg, p, q_ffi::item_size(par.type_id));
+        }
+        return arg;
+    }
+
+}//namespace /*anonymous*/
+
+::K q_ffi::evaluate(::K function, ::K args)
+{
+    using Dot = ::K (*)(::K, ::K);
+    static auto const dot = reinterpret_cast<Dot>(
+        reinterpret_cast<std::uintptr_t>(::dlsym(RTLD_DEFAULT, "dot")));
+    if (nullptr == dot)
+        throw q::K_error("dot not available");
+
+    q::K_ptr result{ dot(function, args) };
+    if (q::kError == q::type(result.get()))
+        throw q::K_error(result.get());
+    return result.release();
+}
+
+Callback::Callback(::K function, Signature signature, std::size_t batch)
+    : function_{ ::r1(function) }, signature_{ std::move(signature) }, plan_{ signature_ },
+    unmarshalers_{}, storers_{}, result_{ nullptr }, thread_{ std::this_thread::get_id() },
+    index_{ 0 }, batch_{ batch },
+    lists_{}, buffered_{ 0 }, arena_{ 256 }, scratch_{ arena_ }
+{
+    auto const& params = signature_.parameters();
+    for (auto const& par : params) {
+        if ((ParamKind::kValue != par.kind && ParamKind::kPointer != par.kind)
+            || nullptr != par.layout || q::kForeign == par.type_id)
+            throw q::K_error("parameter type '" + std::string(1, par.code) + "' not supported in callbacks");
+        unmarshalers_.push_back(select_unmarshaler(par));
+        storers_.push_back(select_storer(par));
+    }
+    if (0 < batch_) {
+        if (q::kNil != signature_.result().type_id)
+            throw q::K_error("batched callbacks must return void");
+        if (params.empty())
+            throw q::K_error("rank");
+    }
+    else if (q::kNil != signature_.result().type_id) {
+        result_ = select_marshaler(signature_.result());
+    }
+    index_ = acquire(this);
+}
+
+Callback::~Callback()
+{
+    trampolines[index_].store(nullptr);
+}
+
+FunctionPtr Callback::pointer() const noexcept
+{
+#ifdef q_ffi_SYSV_CALL
+    return to_function(const_cast<char*>(q_ffi_trampolines + index_ * kTrampolineSize));
+#else
+    return nullptr;
+#endif
+}
+
+void Callback::flush() noexcept
+{
+    if (0 == buffered_)
+        return;
+    try {
+        auto const n = lists_.size();
+        q::K_ptr args{ ::ktn(q::kMixed, static_cast<::J>(n)) };
+        for (std::size_t i = 0; i < n; ++i) {
+            lists_[i]->n = static_cast<::J>(buffered_);
+            kK(args.get())[i] = lists_[i].release();
+        }
+        buffered_ = 0;
+        q::K_ptr result{ q_ffi::evaluate(function_.get(), args.get()) };
+    }
+    catch (q::K_error const& ex) {
+        hold(ex.what());
+    }
+}
+
+void Callback::check()
+{
+    if (!pending) {
+        std::lock_guard<std::mutex> const lock{ stray_lock };
+        if (!stray)
+            return;
+        pending = std::move(stray);
+        stray.reset();
+    }
+    auto const error = std::move(*pending);
+    pending.reset();
+    throw q::K_error(error);
+}
+
+void Callback::dispatch(std::size_t index, Slot* frame, Slot const* stack) noexcept
+{
+    auto const callback = index < kMaxCallbacks ? trampolines[index].load(std::memory_order_relaxed) : nullptr;
+    if (nullptr == callback) {
+        frame[0] = frame[CallPlan::kIntRegs] = 0;
+        return;
+    }
+    if (std::this_thread::get_id() != callback->thread_) {
+        // q is single-threaded: its interpreter and memory must not be touched from here
+        hold_stray("callback invoked off q's main thread");
+        frame[0] = frame[CallPlan::kIntRegs] = 0;
+        return;
+    }
+    if (0 < callback->batch_)
+        callback->buffer(frame, stack);
+    else
+        callback->evaluate(frame, stack);
+}
+
+void Callback::buffer(Slot* frame, Slot const* stack) noexcept
+{
+    auto const& params = signature_.parameters();
+    auto const& layout = plan_.layout();
+    if (0 == buffered_) {
+        lists_.clear();
+        for (auto const& par : params)
+            lists_.emplace_back(::ktn(par.type_id, static_cast<::J>(batch_)));
+    }
+    for (std::size_t i = 0; i < params.size(); ++i)
+        storers_[i](lists_[i].get(), buffered_, argument(params[i], layout[i], frame, stack));
+    if (batch_ == ++buffered_)
+        flush();
+}
+
+void Callback::evaluate(Slot* frame, Slot const* stack) noexcept
+{
+    Slot result = 0;
+    try {
+        auto const& params = signature_.parameters();
+        auto const& layout = plan_.layout();
+        q::K_ptr args{ ::ktn(q::kMixed, static_cast<::J>(std::max<std::size_t>(1, params.size()))) };
+        if (params.empty())
+            kK(args.get())[0] = ::ka(q::kNil);     // f[] is f[::]
+        for (std::size_t i = 0; i < params.size(); ++i)
+            kK(args.get())[i] = unmarshalers_[i](argument(params[i], layout[i], frame, stack));
+
+        q::K_ptr r{ q_ffi::evaluate(function_.get(), args.get()) };
+        if (nullptr != result_) {
+            scratch_.clear();
+            result = result_(r.get(), 0, scratch_);
+        }
+    }
+    catch (q::K_error const& ex) {
+        hold(ex.what());
+    }
+    frame[0] = frame[CallPlan::kIntRegs] = result;
+}
+
+::K Callback::to_q(std::unique_ptr<Callback> callback) noexcept
+{
+    return q::TypeTraits<q::kForeign>::atom(callback.release(), &Callback::finalize);
+}
+
+Callback& Callback::from_q(::K k)
+{
+    using Traits = q::TypeTraits<q::kForeign>;
+    if (!Traits::is_foreign(k, &Callback::finalize))
+        throw q::K_error("type");
+    return *static_cast<Callback*>(Traits::value(k));
+}
+
+::K Callback::finalize(::K k)
+{
+    delete static_cast<Callback*>(q::TypeTraits<q::kForeign>::value(k));
+    return q::Nil;
+}
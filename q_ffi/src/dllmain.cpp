@@ -27,6 +27,8 @@ namespace
         // @ref https://code.kx.com/q/interfaces/c-client-for-q/#managing-memory-and-reference-counting
         std::call_once(onLoad, []() {
 #       ifndef NDEBUG
+            // DLL constructor may run before this unit's <iostream> static init
+            static std::ios_base::Init const iosInit;
             std::cout << "# <" q_ffi_DLL "> loading..." << std::endl;
 #       endif
             ::setm(1);
@@ -0,0 +1,274 @@
+#include "elf.hpp"
+#include "ktype_traits.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#if defined(__linux__)
+#   include <dlfcn.h>
+#   include <link.h>
+#endif
+
+using q_ffi::ElfExports;
+
+#if defined(__linux__)
+
+namespace
+{
+    using Sym = ElfW(Sym);
+    using Word = ElfW(Addr);
+
+    constexpr std::uint16_t kHiddenVersion = 0x8000;
+
+    std::uint32_t gnu_hash(char const* name) noexcept
+    {
+        std::uint32_t h = 5381;
+        for (auto p = reinterpret_cast<unsigned char const*>(name); '\0' != *p; ++p)
+            h = h * 33 + *p;
+        return h;
+    }
+
+    std::uint32_t sysv_hash(char const* name) noexcept
+    {
+        std::uint32_t h = 0;
+        for (auto p = reinterpret_cast<unsigned char const*>(name); '\0' != *p; ++p) {
+            h = (h << 4) + *p;
+            h ^= (h >> 24) & 0xF0;
+        }
+        return h & 0x0FFFFFFF;
+    }
+
+    /// @brief Layout of <code>.gnu.hash</code>: header, Bloom filter, buckets, then hash chains.
+    struct GnuHash
+    {
+        std::uint32_t nbuckets;
+        std::uint32_t symoffset;
+        std::uint32_t bloom_size;
+        std::uint32_t bloom_shift;
+        Word const* bloom;
+        std::uint32_t const* buckets;
+        std::uint32_t const* chains;
+
+        explicit GnuHash(std::uint32_t const* table) noexcept
+            : nbuckets{ table[0] }, symoffset{ table[1] }, bloom_size{ table[2] }, bloom_shift{ table[3] },
+            bloom{ reinterpret_cast<Word const*>(table + 4) },
+            buckets{ reinterpret_cast<std::uint32_t const*>(bloom + bloom_size) },
+            chains{ buckets + nbuckets }
+        {}
+
+        /// @brief The table only records the number of buckets, so count symbols by walking to the end
+        ///     of the last chain.
+        std::size_t symbols() const noexcept
+        {
+            std::uint32_t last = 0;
+            for (std::uint32_t i = 0; i < nbuckets; ++i)
+                last = std::max(last, buckets[i]);
+            if (last < symoffset)
+                return symoffset;
+            while (0 == (chains[last - symoffset] & 1))
+                ++last;
+            return last + 1;
+        }
+
+        bool may_contain(std::uint32_t h) const noexcept
+        {
+            constexpr std::uint32_t bits = sizeof(Word) * 8;
+            auto const word = bloom[(h / bits) % bloom_size];
+            auto const mask = (Word{ 1 } << (h % bits)) | (Word{ 1 } << ((h >> bloom_shift) % bits));
+            return mask == (word & mask);
+        }
+    };
+
+}//namespace /*anonymous*/
+
+ElfExports::ElfExports(void* handle)
+    : base_{ 0 }, symtab_{ nullptr }, strtab_{ nullptr }, versym_{ nullptr },
+    gnu_hash_{ nullptr }, sysv_hash_{ nullptr }, first_{ 0 }, count_{ 0 }
+{
+    ::link_map* map = nullptr;
+    if (0 != ::dlinfo(handle, RTLD_DI_LINKMAP, &map) || nullptr == map || nullptr == map->l_ld)
+        throw q::K_error("elf: no dynamic section");
+    base_ = static_cast<std::uintptr_t>(map->l_addr);
+
+    // glibc relocates the dynamic section in place, other loaders may not
+    auto const address = [this](Word ptr) {
+        return reinterpret_cast<void const*>(ptr < base_ ? base_ + ptr : ptr);
+    };
+    for (auto dyn = map->l_ld; DT_NULL != dyn->d_tag; ++dyn) {
+        switch (dyn->d_tag)
+        {
+        case DT_SYMTAB:
+            symtab_ = address(dyn->d_un.d_ptr);
+            break;
+        case DT_STRTAB:
+            strtab_ = static_cast<char const*>(address(dyn->d_un.d_ptr));
+            break;
+        case DT_VERSYM:
+            versym_ = static_cast<std::uint16_t const*>(address(dyn->d_un.d_ptr));
+            break;
+        case DT_GNU_HASH:
+            gnu_hash_ = static_cast<std::uint32_t const*>(address(dyn->d_un.d_ptr));
+            break;
+        case DT_HASH:
+            sysv_hash_ = static_cast<std::uint32_t const*>(address(dyn->d_un.d_ptr));
+            break;
+        default:
+            break;
+        }
+    }
+    if (nullptr == symtab_ || nullptr == strtab_ || (nullptr == gnu_hash_ && nullptr == sysv_hash_))
+        throw q::K_error("elf: no dynamic symbol table");
+
+    if (nullptr != gnu_hash_) {
+        GnuHash const table{ gnu_hash_ };
+        first_ = table.symoffset;
+        count_ = table.symbols();
+    }
+    else {
+        first_ = 1;
+        count_ = sysv_hash_[1];
+    }
+}
+
+bool ElfExports::exported(std::size_t index, Symbol& symbol) const noexcept
+{
+    auto const& sym = static_cast<Sym const*>(symtab_)[index];
+    if (SHN_UNDEF == sym.st_shndx || 0 == sym.st_name)
+        return false;
+    if (nullptr != versym_ && 0 != (versym_[index] & kHiddenVersion))
+        return false;
+    switch (ELF64_ST_BIND(sym.st_info))
+    {
+    case STB_GLOBAL:
+    case STB_WEAK:
+    case STB_GNU_UNIQUE:
+        break;
+    default:
+        return false;
+    }
+    switch (ELF64_ST_VISIBILITY(sym.st_other))
+    {
+    case STV_DEFAULT:
+    case STV_PROTECTED:
+        break;
+    default:
+        return false;
+    }
+    switch (ELF64_ST_TYPE(sym.st_info))
+    {
+    case STT_FUNC:
+        symbol.kind = Kind::function;
+        break;
+    case STT_GNU_IFUNC:
+        symbol.kind = Kind::indirect;
+        break;
+    case STT_OBJECT:
+    case STT_COMMON:
+    case STT_NOTYPE:
+        symbol.kind = Kind::data;
+        break;
+    default:    // incl. STT_TLS, whose value is not an address
+        return false;
+    }
+    symbol.name = strtab_ + sym.st_name;
+    symbol.address = reinterpret_cast<void*>(
+        SHN_ABS == sym.st_shndx ? sym.st_value : base_ + sym.st_value);
+    symbol.size = static_cast<std::size_t>(sym.st_size);
+    return true;
+}
+
+std::vector<ElfExports::Symbol> ElfExports::list() const
+{
+    std::vector<Symbol> symbols;
+    Symbol symbol{};
+    for (auto i = first_; i < count_; ++i) {
+        if (exported(i, symbol))
+            symbols.push_back(symbol);
+    }
+    return symbols;
+}
+
+void* ElfExports::find(char const* name) const noexcept
+{
+    Symbol symbol{};
+    auto const match = [&](std::size_t i) {
+        return exported(i, symbol) && 0 == std::strcmp(symbol.name, name) && Kind::indirect != symbol.kind;
+    };
+
+    if (nullptr != gnu_hash_) {
+        GnuHash const table{ gnu_hash_ };
+        auto const h = gnu_hash(name);
+        if (0 == table.nbuckets || !table.may_contain(h))
+            return nullptr;
+        auto i = table.buckets[h % table.nbuckets];
+        if (i < table.symoffset)
+            return nullptr;
+        for (;; ++i) {
+            auto const chain = table.chains[i - table.symoffset];
+            if ((h | 1) == (chain | 1) && match(i))
+                return symbol.address;
+            if (0 != (chain & 1))
+                return nullptr;
+        }
+    }
+
+    auto const nbuckets = sysv_hash_[0];
+    auto const buckets = sysv_hash_ + 2;
+    auto const chains = buckets + nbuckets;
+    if (0 == nbuckets)
+        return nullptr;
+    for (auto i = buckets[sysv_hash(name) % nbuckets]; STN_UNDEF != i; i = chains[i]) {
+        if (match(i))
+            return symbol.address;
+    }
+    return nullptr;
+}
+
+std::vector<void*> ElfExports::find_all(std::vector<std::string> const& names) const
+{
+    std::unordered_map<std::string_view, void*> found;
+    found.reserve(names.size());
+    for (auto const& name : names)
+        found.emplace(name, nullptr);
+
+    Symbol symbol{};
+    auto remaining = found.size();
+    for (auto i = first_; 0 < remaining && i < count_; ++i) {
+        if (!exported(i, symbol) || Kind::indirect == symbol.kind)
+            continue;
+        auto const it = found.find(symbol.name);
+        if (found.end() != it && nullptr == it->second) {
+            it->second = symbol.address;
+            --remaining;
+        }
+    }
+
+    std::vector<void*> addresses;
+    addresses.reserve(names.size());
+    for (auto const& name : names)
+        addresses.push_back(found[name]);
+    return addresses;
+}
+
+#else
+
+ElfExports::ElfExports(void*)
+    : base_{ 0 }, symtab_{ nullptr }, strtab_{ nullptr }, versym_{ nullptr },
+    gnu_hash_{ nullptr }, sysv_hash_{ nullptr }, first_{ 0 }, count_{ 0 }
+{
+    throw q::K_error("nyi");
+}
+
+bool ElfExports::exported(std::size_t, Symbol&) const noexcept
+{ return false; }
+
+std::vector<ElfExports::Symbol> ElfExports::list() const
+{ return {}; }
+
+void* ElfExports::find(char const*) const noexcept
+{ return nullptr; }
+
+std::vector<void*> ElfExports::find_all(std::vector<std::string> const& names) const
+{ return std::vector<void*>(names.size(), nullptr); }
+
+#endif
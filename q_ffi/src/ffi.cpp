@@ -1,28 +1,576 @@
 #include "ktype_traits.hpp"
+#include "kview.hpp"
 #include "ffi.h"
-#include <dlfcn.h>
+#include "binding.hpp"
+#include "callback.hpp"
+#include "handle.hpp"
+#include "async.hpp"
+#include "library.hpp"
+#include "marshal.hpp"
+#include "prototype.hpp"
+#include "signature_of.hpp"
+#include "stats.hpp"
+#include "workers.hpp"
 #include "version.hpp"
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <sstream>
 
-#include <iostream>
-::K K4_DECL load(::K dllSym, ::K fName, ::K resType, ::K parTypes)
-{
-//    auto dll = q::q2Str(dllSym);
-    ++dllSym;
-	fName++;
-	resType++;
-	parTypes++;
-    return ::krr("error!");
-    /*
-    auto handle = dlopen("QQQQQ:kernel32.dll", RTLD_NOW);
-    std::cout << handle << std::endl;
-    if (!handle) {
-        return q::error("failed to load kernel32.dll", true);
-    }
-    else {
-        dlclose(handle);
-    }
-	return version(nullptr);
-    */
+#ifdef _WIN32
+#   define q_ffi_DLL_EXT ".dll"
+#else
+#   define q_ffi_DLL_EXT ".so"
+#endif
+
+namespace
+{
+    /// @brief Check @c signature against the one advertised by @c library for function @c name, if any.
+    /// @throw q::K_error If they differ.
+    void check_signature(q_ffi::Library& library, std::string const& name, q_ffi::Signature const& signature)
+    {
+        auto const advertised = static_cast<char const* const*>(library.find(q_ffi_SIGNATURE_PREFIX + name));
+        if (nullptr == advertised || nullptr == *advertised)
+            return;
+        auto const native = signature.native_str();
+        if (native != *advertised)
+            throw q::K_error("signature mismatch: " + native + " vs " + *advertised);
+    }
+
+    /// @brief Resolve a q file symbol (e.g. <code>`:libm</code>) into a path for @c dlopen.
+    ///     Similar to <code>2:</code>, platform-specific extension is added if none is given.
+    std::string to_library_path(std::string path)
+    {
+        if (!path.empty() && ':' == path.front())
+            path.erase(0, 1);
+        if (path.empty())
+            return path;
+
+        auto const sep = path.find_last_of("/\\");
+        auto const base = std::string::npos == sep ? 0 : sep + 1;
+        if (std::string::npos == path.find('.', base))
+            path += q_ffi_DLL_EXT;
+        return path;
+    }
+
+    template<q::TypeId tid>
+    bool get_item(::K k, std::size_t i, typename q::TypeTraits<tid>::value_type& v) noexcept
+    {
+        using Traits = q::TypeTraits<tid>;
+        if (-tid == q::type(k))
+            v = Traits::value(k);
+        else if (tid == q::type(k))
+            v = Traits::index(k)[i];
+        else
+            return false;
+        return true;
+    }
+
+    /// @brief Integral (or boolean) item @c i from a list, or from an atom if @c i is 0.
+    ::J to_long(::K k, std::size_t i)
+    {
+        if (q::kMixed == q::type(k)) {
+            k = q::TypeTraits<q::kMixed>::index(k)[i];
+            i = 0;
+        }
+        q::TypeTraits<q::kLong>::value_type j;
+        q::TypeTraits<q::kInt>::value_type n;
+        q::TypeTraits<q::kShort>::value_type h;
+        q::TypeTraits<q::kBoolean>::value_type b;
+        if (get_item<q::kLong>(k, i, j))
+            return j;
+        if (get_item<q::kInt>(k, i, n))
+            return n;
+        if (get_item<q::kShort>(k, i, h))
+            return h;
+        if (get_item<q::kBoolean>(k, i, b))
+            return b;
+        throw q::K_error("type");
+    }
+
+    /// @brief Symbol item @c i from a symbol list, or atom @c i of a general list.
+    std::string to_symbol(::K k, std::size_t i)
+    {
+        if (q::kMixed == q::type(k)) {
+            k = q::TypeTraits<q::kMixed>::index(k)[i];
+            if (-q::kSymbol != q::type(k))
+                throw q::K_error("type");
+            i = 0;
+        }
+        q::TypeTraits<q::kSymbol>::value_type s;
+        if (!get_item<q::kSymbol>(k, i, s))
+            throw q::K_error("type");
+        return s;
+    }
+
+    /// @brief @c dlopen flags from symbols, e.g. <code>`lazy`global</code>.
+    int to_dlflags(::K k)
+    {
+        if (-q::kSymbol != q::type(k) && q::kSymbol != q::type(k))
+            throw q::K_error("type");
+        auto const n = q::kSymbol == q::type(k) ? static_cast<std::size_t>(q::count(k)) : 1u;
+        auto flags = q_ffi::Library::kDefaultFlags;
+        for (std::size_t i = 0; i < n; ++i) {
+            std::string const flag{ 0 > q::type(k)
+                ? q::TypeTraits<q::kSymbol>::value(k) : q::TypeTraits<q::kSymbol>::index(k)[i] };
+            if ("now" == flag)
+                flags = (flags & ~RTLD_LAZY) | RTLD_NOW;
+            else if ("lazy" == flag)
+                flags = (flags & ~RTLD_NOW) | RTLD_LAZY;
+            else if ("local" == flag)
+                flags = (flags & ~RTLD_GLOBAL) | RTLD_LOCAL;
+            else if ("global" == flag)
+                flags = (flags & ~RTLD_LOCAL) | RTLD_GLOBAL;
+#ifdef RTLD_DEEPBIND
+            else if ("deepbind" == flag)
+                flags |= RTLD_DEEPBIND;
+#endif
+            else
+                throw q::K_error(flag);
+        }
+        return flags;
+    }
+
+    /// @brief Simple list type of a type code, as in signatures (e.g. <code>"f"</code> or <code>"F"</code>).
+    q::TypeId to_list_type(::K code)
+    {
+        if (-q::kChar != q::type(code))
+            throw q::K_error("type");
+        auto const c = static_cast<char>(std::tolower(static_cast<unsigned char>(q::TypeTraits<q::kChar>::value(code))));
+        for (auto const& [tid, tc] : q::TypeCode) {
+            if (c == tc && 0 < q_ffi::item_size(tid))
+                return tid;
+        }
+        throw q::K_error(std::string(1, c));
+    }
+
+    struct LoadOptions
+    {
+        q_ffi::BindingOptions binding;
+        int dlflags = q_ffi::Library::kDefaultFlags;
+        /// @brief If functions are only to be resolved when first called.
+        bool lazy = false;
+        /// @brief Symbol of the destructor of returned handles, resolved from the same library.
+        std::string destructor;
+    };
+
+    /// @param options A dictionary from option names to values, or generic null for defaults.
+    LoadOptions to_options(::K options)
+    {
+        LoadOptions result;
+        if (q::kNil == q::type(options) || (0 <= q::type(options) && 0 == q::count(options)))
+            return result;
+        if (q::kDict != q::type(options))
+            throw q::K_error("type");
+
+        auto const keys = q::TypeTraits<q::kMixed>::index(options)[0];
+        auto const values = q::TypeTraits<q::kMixed>::index(options)[1];
+        if (q::kSymbol != q::type(keys))
+            throw q::K_error("type");
+        for (std::size_t i = 0; i < static_cast<std::size_t>(q::count(keys)); ++i) {
+            std::string const key{ q::TypeTraits<q::kSymbol>::index(keys)[i] };
+            if ("parallel" == key) {
+                result.binding.parallel = 0 != to_long(values, i);
+            }
+            else if ("grain" == key) {
+                auto const grain = to_long(values, i);
+                if (grain <= 0)
+                    throw q::K_error("domain");
+                result.binding.grain = static_cast<std::size_t>(grain);
+            }
+            else if ("lazy" == key) {
+                result.lazy = 0 != to_long(values, i);
+            }
+            else if ("flags" == key) {
+                if (q::kMixed == q::type(values)) {
+                    result.dlflags = to_dlflags(q::TypeTraits<q::kMixed>::index(values)[i]);
+                }
+                else {
+                    q::K_ptr const flag{ q::TypeTraits<q::kSymbol>::atom(to_symbol(values, i).c_str()) };
+                    result.dlflags = to_dlflags(flag.get());
+                }
+            }
+            else if ("destructor" == key) {
+                result.destructor = to_symbol(values, i);
+            }
+            else {
+                throw q::K_error(key);
+            }
+        }
+        return result;
+    }
+
+    /// @brief One function listed in a manifest.
+    struct ManifestEntry
+    {
+        std::string name;
+        std::string resType;
+        std::string parTypes;
+    };
+
+    /// @brief Parse manifest lines of the form <code>name result params</code>, separated by blanks,
+    ///     where a @c void result is written as <code>_</code>, and params as <code>_</code> (or omitted)
+    ///     for none.
+    ///     Blank lines, and lines starting with <code>/</code>, are skipped.
+    /// @param lines A list of strings, or a single string of newline-separated lines.
+    std::vector<ManifestEntry> parse_manifest(::K lines)
+    {
+        std::vector<std::string> texts;
+        if (q::kChar == q::type(lines)) {
+            std::istringstream all{ q::q2Str(lines) };
+            for (std::string line; std::getline(all, line);)
+                texts.push_back(std::move(line));
+        }
+        else if (q::kMixed == q::type(lines)) {
+            q::KView<q::kMixed> const items{ lines };
+            std::transform(items.begin(), items.end(), std::back_inserter(texts), &q::q2Str);
+        }
+        else if (q::kSymbol != q::type(lines) || 0 != q::count(lines)) {
+            throw q::K_error("type");
+        }
+
+        std::vector<ManifestEntry> entries;
+        entries.reserve(texts.size());
+        for (std::size_t i = 0; i < texts.size(); ++i) {
+            std::istringstream line{ texts[i] };
+            ManifestEntry entry;
+            if (!(line >> entry.name) || '/' == entry.name.front())
+                continue;
+            std::string extra;
+            if (!(line >> entry.resType) || (line >> entry.parTypes && line >> extra))
+                throw q::K_error("manifest line " + std::to_string(i + 1) + ": expected name result params");
+            if ("_" == entry.resType)
+                entry.resType = " ";
+            if ("_" == entry.parTypes)
+                entry.parTypes.clear();
+            entries.push_back(std::move(entry));
+        }
+        return entries;
+    }
+
+    template<typename... Args>
+    ::K call(::K binding, Args... args) noexcept
+    {
+        try {
+            auto const& bound = q_ffi::Binding::from_q(binding);
+            if (sizeof...(args) != bound.rank())
+                throw q::K_error("rank");
+            ::K const argv[] = { args..., q::Nil };
+            return bound(argv);
+        }
+        catch (q::K_error const& ex) {
+            return ex.report();
+        }
+    }
+
+}//namespace /*anonymous*/
+
+::K K4_DECL load(::K dllSym, ::K fName, ::K resType, ::K parTypes, ::K options)
+{
+    try {
+        q_ffi::Signature signature{ q::q2Str(resType), q::q2Str(parTypes) };
+        auto const name = q::q2Str(fName);
+        auto opts = to_options(options);
+        opts.binding.name = name;
+        auto library = q_ffi::Library::open(to_library_path(q::q2Str(dllSym)), opts.dlflags);
+        auto const fn = library->resolve(name);
+        if (!opts.destructor.empty())
+            opts.binding.destructor = library->resolve(opts.destructor);
+        check_signature(*library, name, signature);
+        return q_ffi::Binding::to_q(
+            std::make_unique<q_ffi::Binding>(fn, std::move(signature), std::move(library), opts.binding));
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL bindAll(::K dllSym, ::K manifest, ::K options)
+{
+    try {
+        auto const entries = parse_manifest(manifest);
+        auto opts = to_options(options);
+        auto library = q_ffi::Library::open(to_library_path(q::q2Str(dllSym)), opts.dlflags);
+        if (!opts.destructor.empty())
+            opts.binding.destructor = library->resolve(opts.destructor);
+
+        std::vector<std::string> symbols;
+        std::transform(entries.cbegin(), entries.cend(), std::back_inserter(symbols),
+            [](ManifestEntry const& entry) { return entry.name; });
+        std::vector<q_ffi::FunctionPtr> fns;
+        if (!opts.lazy)
+            fns = library->resolve(symbols);    // in one walk of the symbol table
+
+        std::vector<char const*> names;
+        q::K_ptr bindings{ ::ktn(q::kMixed, static_cast<::J>(entries.size())) };
+        bindings->n = 0;    // grown as bindings are created, to be released on error
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            auto const& entry = entries[i];
+            try {
+                q_ffi::Signature signature{ entry.resType, entry.parTypes };
+                auto binding = opts.binding;
+                binding.name = entry.name;
+                std::unique_ptr<q_ffi::Binding> bound;
+                if (opts.lazy) {
+                    bound = std::make_unique<q_ffi::Binding>(library, entry.name, std::move(signature), binding);
+                }
+                else {
+                    check_signature(*library, entry.name, signature);
+                    bound = std::make_unique<q_ffi::Binding>(fns[i], std::move(signature), library, binding);
+                }
+                kK(bindings.get())[bindings->n++] = q_ffi::Binding::to_q(std::move(bound));
+                names.push_back(entry.name.c_str());
+            }
+            catch (q::K_error const& ex) {
+                throw q::K_error(entry.name + ": " + ex.what());
+            }
+        }
+        return ::xD(q::TypeTraits<q::kSymbol>::list(names.cbegin(), names.cend()), bindings.release());
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL exports(::K dllSym)
+{
+    try {
+        auto const library = q_ffi::Library::open(to_library_path(q::q2Str(dllSym)));
+        auto const symbols = library->exports().list();
+        std::vector<char const*> names, kinds;
+        q::K_ptr sizes{ ::ktn(q::kLong, static_cast<::J>(symbols.size())) };
+        for (std::size_t i = 0; i < symbols.size(); ++i) {
+            names.push_back(symbols[i].name);
+            kinds.push_back(q_ffi::ElfExports::Kind::data == symbols[i].kind ? "data" : "function");
+            q::TypeTraits<q::kLong>::index(sizes.get())[i] = static_cast<::J>(symbols[i].size);
+        }
+        q::K_ptr keys{ q::TypeTraits<q::kSymbol>::list({ "name", "kind", "size" }) };
+        q::K_ptr columns{ ::knk(3,
+            q::TypeTraits<q::kSymbol>::list(names.cbegin(), names.cend()),
+            q::TypeTraits<q::kSymbol>::list(kinds.cbegin(), kinds.cend()),
+            sizes.release()) };
+        return ::xT(::xD(keys.release(), columns.release()));
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL unload(::K dllSym)
+{
+    try {
+        auto const unloaded = q_ffi::Library::unload(to_library_path(q::q2Str(dllSym)));
+        return q::TypeTraits<q::kBoolean>::atom(unloaded);
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL rank(::K binding)
+{
+    try {
+        auto const& bound = q_ffi::Binding::from_q(binding);
+        return q::TypeTraits<q::kLong>::atom(static_cast<::J>(bound.rank()));
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL call0(::K binding, ::K)
+{ return call(binding); }
+
+::K K4_DECL call1(::K binding, ::K x1)
+{ return call(binding, x1); }
+
+::K K4_DECL call2(::K binding, ::K x1, ::K x2)
+{ return call(binding, x1, x2); }
+
+::K K4_DECL call3(::K binding, ::K x1, ::K x2, ::K x3)
+{ return call(binding, x1, x2, x3); }
+
+::K K4_DECL call4(::K binding, ::K x1, ::K x2, ::K x3, ::K x4)
+{ return call(binding, x1, x2, x3, x4); }
+
+::K K4_DECL call5(::K binding, ::K x1, ::K x2, ::K x3, ::K x4, ::K x5)
+{ return call(binding, x1, x2, x3, x4, x5); }
+
+::K K4_DECL call6(::K binding, ::K x1, ::K x2, ::K x3, ::K x4, ::K x5, ::K x6)
+{ return call(binding, x1, x2, x3, x4, x5, x6); }
+
+::K K4_DECL call7(::K binding, ::K x1, ::K x2, ::K x3, ::K x4, ::K x5, ::K x6, ::K x7)
+{ return call(binding, x1, x2, x3, x4, x5, x6, x7); }
+
+::K K4_DECL callv(::K binding, ::K args)
+{
+    try {
+        return q_ffi::Binding::from_q(binding).apply(args);
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL callRows(::K binding, ::K table)
+{
+    try {
+        return q_ffi::Binding::from_q(binding).apply_rows(table);
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL post(::K binding, ::K args, ::K callback)
+{
+    try {
+        q_ffi::Binding::post(binding, args, callback);
+        return q::TypeTraits<q::kNil>::atom();
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL release(::K handle)
+{
+    try {
+        q_ffi::Handle::from_q(handle).release();
+        return q::TypeTraits<q::kNil>::atom();
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL alloc(::K type, ::K count, ::K alignment)
+{
+    try {
+        auto const tid = to_list_type(type);
+        auto const n = to_long(count, 0);
+        auto const align = q::kNil == q::type(alignment) ? static_cast<::J>(q_ffi::kBufferAlignment)
+            : to_long(alignment, 0);
+        if (n < 0 || align <= 0)
+            throw q::K_error("domain");
+        return q_ffi::Handle::to_q(
+            q_ffi::Handle::allocate(tid, static_cast<std::size_t>(n), static_cast<std::size_t>(align)));
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL copyIn(::K buffer, ::K list)
+{
+    try {
+        q_ffi::Handle::from_q(buffer).copy_in(list);
+        return q::TypeTraits<q::kNil>::atom();
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL copyOut(::K buffer)
+{
+    try {
+        return q_ffi::Handle::from_q(buffer).copy_out();
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL drain(::K wait)
+{
+    try {
+        auto const block = q::kNil != q::type(wait) && 0 != to_long(wait, 0);
+        auto const delivered = q_ffi::AsyncQueue::instance().drain(block);
+        return q::TypeTraits<q::kLong>::atom(static_cast<::J>(delivered));
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL callback(::K function, ::K resType, ::K parTypes, ::K batch)
+{
+    try {
+        q_ffi::Signature signature{ q::q2Str(resType), q::q2Str(parTypes) };
+        auto const n = q::kNil == q::type(batch) ? 0 : to_long(batch, 0);
+        if (n < 0)
+            throw q::K_error("domain");
+        return q_ffi::Callback::to_q(
+            std::make_unique<q_ffi::Callback>(function, std::move(signature), static_cast<std::size_t>(n)));
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL flush(::K callback)
+{
+    try {
+        q_ffi::Callback::from_q(callback).flush();
+        q_ffi::Callback::check();
+        return q::TypeTraits<q::kNil>::atom();
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL threads(::K count)
+{
+    try {
+        auto& pool = q_ffi::WorkerPool::instance();
+        if (q::kNil != q::type(count)) {
+            auto const n = to_long(count, 0);
+            if (n < 0)
+                throw q::K_error("domain");
+            pool.resize(static_cast<std::size_t>(n));
+        }
+        return q::TypeTraits<q::kLong>::atom(static_cast<::J>(pool.size()));
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL signatures(::K)
+{
+    try {
+        return q_ffi::Prototype::table();
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL stats(::K reset)
+{
+    try {
+        q::K_ptr table{ q_ffi::CallStats::table() };
+        if (q::kNil != q::type(reset) && 0 != to_long(reset, 0))
+            q_ffi::CallStats::reset_all();
+        return table.release();
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
+}
+
+::K K4_DECL profile(::K on)
+{
+    try {
+        auto const enabled = q::kNil == q::type(on)
+            ? q_ffi::CallStats::enabled() : q_ffi::CallStats::enable(0 != to_long(on, 0));
+        return q::TypeTraits<q::kBoolean>::atom(enabled);
+    }
+    catch (q::K_error const& ex) {
+        return ex.report();
+    }
 }
 
 ::K K4_DECL version(K)
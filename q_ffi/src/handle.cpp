@@ -0,0 +1,118 @@
+#include "handle.hpp"
+#include "ktype_traits.hpp"
+#include "marshal.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#ifdef _WIN32
+#   include <malloc.h>
+#endif
+
+using q_ffi::Handle;
+
+namespace
+{
+    void free_buffer(void* buffer)
+    {
+#ifdef _WIN32
+        ::_aligned_free(buffer);
+#else
+        std::free(buffer);
+#endif
+    }
+
+}//namespace /*anonymous*/
+
+Handle::Handle(void* pointer, FunctionPtr destructor, std::shared_ptr<void> library)
+    : pointer_{ pointer }, destructor_{ destructor }, library_{ std::move(library) }, type_{ q::kNil }, count_{ 0 }
+{}
+
+std::unique_ptr<Handle> Handle::allocate(q::TypeId tid, std::size_t n, std::size_t alignment)
+{
+    auto const width = item_size(tid);
+    if (0 == width || q::kSymbol == tid)
+        throw q::K_error("type");
+    if (0 == alignment || 0 != (alignment & (alignment - 1)))
+        throw q::K_error("domain");
+    alignment = std::max(alignment, sizeof(void*));
+    // the count must fit a q list, and its size (rounded up) a size_t
+    if (static_cast<std::uint64_t>(std::numeric_limits<::J>::max()) < n
+        || (std::numeric_limits<std::size_t>::max() - (alignment - 1)) / width < n)
+        throw q::K_error("wsfull");
+
+    // aligned_alloc wants a whole number of alignment units
+    auto const size = std::max<std::size_t>((n * width + alignment - 1) & ~(alignment - 1), alignment);
+#ifdef _WIN32
+    auto const buffer = ::_aligned_malloc(size, alignment);
+#else
+    auto const buffer = std::aligned_alloc(alignment, size);
+#endif
+    if (nullptr == buffer)
+        throw q::K_error("wsfull");
+    std::memset(buffer, 0, size);
+
+    auto handle = std::make_unique<Handle>(buffer, reinterpret_cast<FunctionPtr>(&free_buffer));
+    handle->type_ = tid;
+    handle->count_ = n;
+    return handle;
+}
+
+Handle::~Handle()
+{
+    release();
+}
+
+void Handle::release() noexcept
+{
+    auto const pointer = pointer_;
+    pointer_ = nullptr;
+    if (nullptr != pointer && nullptr != destructor_)
+        reinterpret_cast<void (*)(void*)>(destructor_)(pointer);
+}
+
+void Handle::check_buffer() const
+{
+    if (!is_buffer())
+        throw q::K_error("type");
+    if (nullptr == pointer_)
+        throw q::K_error("released");
+}
+
+void Handle::copy_in(::K list)
+{
+    check_buffer();
+    if (type_ != q::type(list))
+        throw q::K_error("type");
+    auto const n = static_cast<std::size_t>(q::count(list));
+    if (count_ < n)
+        throw q::K_error("length");
+    std::memcpy(pointer_, kG(list), n * item_size(type_));
+}
+
+::K Handle::copy_out() const
+{
+    check_buffer();
+    q::K_ptr list{ ::ktn(type_, static_cast<::J>(count_)) };
+    std::memcpy(kG(list.get()), pointer_, count_ * item_size(type_));
+    return list.release();
+}
+
+::K Handle::to_q(std::unique_ptr<Handle> handle) noexcept
+{
+    return q::TypeTraits<q::kForeign>::atom(handle.release(), &Handle::finalize);
+}
+
+Handle& Handle::from_q(::K k)
+{
+    using Traits = q::TypeTraits<q::kForeign>;
+    if (!Traits::is_foreign(k, &Handle::finalize))
+        throw q::K_error("type");
+    return *static_cast<Handle*>(Traits::value(k));
+}
+
+::K Handle::finalize(::K k)
+{
+    delete static_cast<Handle*>(q::TypeTraits<q::kForeign>::value(k));
+    return q::Nil;
+}
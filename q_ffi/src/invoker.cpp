@@ -0,0 +1,136 @@
+#include "invoker.hpp"
+#include "ktype_traits.hpp"
+#include <array>
+#include <utility>
+
+using q_ffi::CallFn;
+using q_ffi::FunctionPtr;
+using q_ffi::NativeClass;
+using q_ffi::Slot;
+
+#if defined(__x86_64__) || defined(_M_X64)
+#   define q_ffi_GENERIC_CALL 1
+#endif
+
+#pragma region Generic call stubs
+/// @remark On x86-64 (both System V and Microsoft ABIs), each argument of up to 8 bytes occupies
+///     a full register or stack word: integer arguments of any width can be passed as @c Slot,
+///     while floating-point arguments only need to be distinguished from integer ones, as a
+///     @c float is read from the low 32 bits of the vector register (or stack word) holding it.
+///     Results are likewise returned in @c rax or @c xmm0.
+///     Hence a stub only depends on the number of arguments and which of them are floating-point.
+#ifdef q_ffi_GENERIC_CALL
+namespace
+{
+    template<bool isFloat>
+    struct ArgType
+    { using type = Slot; };
+
+    template<>
+    struct ArgType<true>
+    { using type = double; };
+
+    template<bool isFloat>
+    typename ArgType<isFloat>::type pass(Slot s) noexcept
+    {
+        typename ArgType<isFloat>::type v;
+        static_assert(sizeof(v) == sizeof(s), "sizeof(arg) == sizeof(Slot)");
+        std::memcpy(&v, &s, sizeof(v));
+        return v;
+    }
+
+    template<typename T>
+    Slot to_slot(T v) noexcept
+    {
+        Slot s;
+        static_assert(sizeof(v) == sizeof(s), "sizeof(result) == sizeof(Slot)");
+        std::memcpy(&s, &v, sizeof(s));
+        return s;
+    }
+
+    template<typename Res, unsigned mask, typename Seq>
+    struct Stub;
+
+    /// @tparam Res  @c void, @c Slot or @c double
+    /// @tparam mask Bit @c i is set if argument @c i is floating-point
+    template<typename Res, unsigned mask, std::size_t... I>
+    struct Stub<Res, mask, std::index_sequence<I...>>
+    {
+        using Fn = Res (*)(typename ArgType<0 != ((mask >> I) & 1u)>::type...);
+
+        static Slot call(FunctionPtr fn, Slot const* args)
+        {
+            static_cast<void>(args);
+            auto const f = reinterpret_cast<Fn>(fn);
+            if constexpr (std::is_void_v<Res>) {
+                f(pass<0 != ((mask >> I) & 1u)>(args[I])...);
+                return 0;
+            }
+            else {
+                return to_slot(f(pass<0 != ((mask >> I) & 1u)>(args[I])...));
+            }
+        }
+    };
+
+    template<typename Res, std::size_t N, unsigned... masks>
+    constexpr std::array<CallFn, sizeof...(masks)> make_stubs(std::integer_sequence<unsigned, masks...>)
+    {
+        return { &Stub<Res, masks, std::make_index_sequence<N>>::call... };
+    }
+
+    template<typename Res, std::size_t N>
+    CallFn stub_of(unsigned mask) noexcept
+    {
+        static constexpr auto stubs = make_stubs<Res, N>(std::make_integer_sequence<unsigned, (1u << N)>());
+        return stubs[mask];
+    }
+
+    template<typename Res, std::size_t... N>
+    CallFn stub_of(std::size_t n, unsigned mask, std::index_sequence<N...>) noexcept
+    {
+        static constexpr CallFn (*lookup[])(unsigned) = { &stub_of<Res, N>... };
+        return lookup[n](mask);
+    }
+
+}//namespace /*anonymous*/
+#endif
+#pragma endregion
+
+CallFn q_ffi::select_call(Signature const& sig)
+{
+#ifdef q_ffi_GENERIC_CALL
+    auto const& params = sig.parameters();
+    if (kMaxCallArgs < params.size())
+        throw q::K_error("too many parameters");
+
+    unsigned mask = 0u;
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        if (NativeClass::kInteger != params[i].native)
+            mask |= 1u << i;
+    }
+
+    using All = std::make_index_sequence<kMaxCallArgs + 1>;
+    switch (sig.result().native)
+    {
+    case NativeClass::kVoid:
+        return stub_of<void>(params.size(), mask, All{});
+    case NativeClass::kInteger:
+        return stub_of<Slot>(params.size(), mask, All{});
+    case NativeClass::kSingle:
+    case NativeClass::kDouble:
+        return stub_of<double>(params.size(), mask, All{});
+    default:
+        throw q::K_error("result type not supported");
+    }
+#else
+    static_cast<void>(sig);
+    throw q::K_error("nyi");
+#endif
+}
+
+q_ffi::Invoker::Invoker(Signature const& sig)
+    : stub_{ sig.parameters().size() <= kMaxCallArgs && !sig.is_variadic() ? select_call(sig) : nullptr }, plan_{}
+{
+    if (nullptr == stub_)
+        plan_.emplace(sig);
+}
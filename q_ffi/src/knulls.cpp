@@ -0,0 +1,231 @@
+#include "knulls.hpp"
+#include <cassert>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#   include <immintrin.h>
+#   define q_ffi_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace
+{
+    std::size_t popcount(std::uint32_t mask) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<std::size_t>(__builtin_popcount(mask));
+#else
+        std::size_t n = 0;
+        for (; 0 != mask; mask &= mask - 1)
+            ++n;
+        return n;
+#endif
+    }
+
+    std::size_t lowest_bit(std::uint32_t mask) noexcept
+    {
+        assert(0 != mask);
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<std::size_t>(__builtin_ctz(mask));
+#else
+        std::size_t i = 0;
+        for (; 0 == (mask & 1); mask >>= 1)
+            ++i;
+        return i;
+#endif
+    }
+
+    /// @brief Items of @c W bytes are scanned in groups of as many as fit in 256 bits, each reported as
+    ///     a mask with one bit per matching item. Groups start at multiples of their size,
+    ///     so that their masks never straddle two words of a bitmap.
+    template<std::size_t W>
+    constexpr std::size_t kLanes = 32 / W;
+
+    /// @brief Scan items from @c i onwards, one at a time.
+    /// @return @c false if @c visit stopped the scan.
+    template<std::size_t W, typename Visit>
+    bool scan_scalar(char const* data, std::size_t& i, std::size_t n,
+        std::uint64_t pattern, std::uint64_t other, Visit&& visit)
+    {
+        for (; i < n; i += kLanes<W>) {
+            auto const lanes = std::min(kLanes<W>, n - i);
+            std::uint32_t mask = 0;
+            for (std::size_t k = 0; k < lanes; ++k) {
+                std::uint64_t item = 0;
+                std::memcpy(&item, data + (i + k) * W, W);
+                if (pattern == item || other == item)
+                    mask |= std::uint32_t{ 1 } << k;
+            }
+            if (!visit(i, mask))
+                return false;
+        }
+        return true;
+    }
+
+#ifdef q_ffi_AVX2
+
+    template<std::size_t W>
+    struct Avx2;
+
+    template<>
+    struct Avx2<1>
+    {
+        q_ffi_AVX2 static __m256i broadcast(std::uint64_t p) noexcept
+        { return _mm256_set1_epi8(static_cast<char>(p)); }
+
+        q_ffi_AVX2 static __m256i equal(__m256i a, __m256i b) noexcept
+        { return _mm256_cmpeq_epi8(a, b); }
+
+        q_ffi_AVX2 static std::uint32_t mask(__m256i eq) noexcept
+        { return static_cast<std::uint32_t>(_mm256_movemask_epi8(eq)); }
+    };
+
+    template<>
+    struct Avx2<2>
+    {
+        q_ffi_AVX2 static __m256i broadcast(std::uint64_t p) noexcept
+        { return _mm256_set1_epi16(static_cast<short>(p)); }
+
+        q_ffi_AVX2 static __m256i equal(__m256i a, __m256i b) noexcept
+        { return _mm256_cmpeq_epi16(a, b); }
+
+        /// @brief Saturating both halves down to bytes keeps one byte per item, in order.
+        q_ffi_AVX2 static std::uint32_t mask(__m256i eq) noexcept
+        {
+            auto const bytes = _mm_packs_epi16(_mm256_castsi256_si128(eq), _mm256_extracti128_si256(eq, 1));
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(bytes));
+        }
+    };
+
+    template<>
+    struct Avx2<4>
+    {
+        q_ffi_AVX2 static __m256i broadcast(std::uint64_t p) noexcept
+        { return _mm256_set1_epi32(static_cast<int>(p)); }
+
+        q_ffi_AVX2 static __m256i equal(__m256i a, __m256i b) noexcept
+        { return _mm256_cmpeq_epi32(a, b); }
+
+        q_ffi_AVX2 static std::uint32_t mask(__m256i eq) noexcept
+        { return static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(eq))); }
+    };
+
+    template<>
+    struct Avx2<8>
+    {
+        q_ffi_AVX2 static __m256i broadcast(std::uint64_t p) noexcept
+        { return _mm256_set1_epi64x(static_cast<long long>(p)); }
+
+        q_ffi_AVX2 static __m256i equal(__m256i a, __m256i b) noexcept
+        { return _mm256_cmpeq_epi64(a, b); }
+
+        q_ffi_AVX2 static std::uint32_t mask(__m256i eq) noexcept
+        { return static_cast<std::uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(eq))); }
+    };
+
+    /// @brief Scan whole groups of items from @c i onwards, leaving the last partial group (if any).
+    /// @remark Items are compared as integers, so that bit patterns are matched exactly
+    ///     (e.g. a NaN null only matches the very same NaN).
+    template<std::size_t W, typename Visit>
+    q_ffi_AVX2 bool scan_avx2(char const* data, std::size_t& i, std::size_t n,
+        std::uint64_t pattern, std::uint64_t other, Visit&& visit)
+    {
+        using Ops = Avx2<W>;
+        auto const p = Ops::broadcast(pattern), o = Ops::broadcast(other);
+        for (; i + kLanes<W> <= n; i += kLanes<W>) {
+            auto const items = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i * W));
+            auto const eq = _mm256_or_si256(Ops::equal(items, p), Ops::equal(items, o));
+            if (!visit(i, Ops::mask(eq)))
+                return false;
+        }
+        return true;
+    }
+
+    bool has_avx2() noexcept
+    {
+        static bool const supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+#endif
+
+    template<std::size_t W, typename Visit>
+    void scan(void const* data, std::size_t n, std::uint64_t pattern, std::uint64_t other, Visit&& visit)
+    {
+        auto const items = static_cast<char const*>(data);
+        std::size_t i = 0;
+#ifdef q_ffi_AVX2
+        if (has_avx2() && !scan_avx2<W>(items, i, n, pattern, other, visit))
+            return;
+#endif
+        scan_scalar<W>(items, i, n, pattern, other, visit);
+    }
+
+    /// @brief Call <code>visit(first, mask)</code> for each group of items, where bit @c k of @c mask is set
+    ///     if item <code>first + k</code> matches either pattern, until @c visit returns @c false.
+    template<typename Visit>
+    void scan(void const* data, std::size_t n, std::size_t width,
+        std::uint64_t pattern, std::uint64_t other, Visit&& visit)
+    {
+        switch (width)
+        {
+        case 1:
+            return scan<1>(data, n, pattern, other, visit);
+        case 2:
+            return scan<2>(data, n, pattern, other, visit);
+        case 4:
+            return scan<4>(data, n, pattern, other, visit);
+        case 8:
+            return scan<8>(data, n, pattern, other, visit);
+        default:
+            assert(!"unsupported item width");
+        }
+    }
+
+}//namespace /*anonymous*/
+
+std::size_t q::details::count_equal(void const* data, std::size_t n, std::size_t width,
+    std::uint64_t pattern) noexcept
+{
+    std::size_t total = 0;
+    scan(data, n, width, pattern, pattern, [&total](std::size_t, std::uint32_t mask) {
+        total += popcount(mask);
+        return true;
+    });
+    return total;
+}
+
+std::size_t q::details::find_equal(void const* data, std::size_t n, std::size_t width,
+    std::uint64_t pattern, std::uint64_t other) noexcept
+{
+    auto found = n;
+    scan(data, n, width, pattern, other, [&found](std::size_t first, std::uint32_t mask) {
+        if (0 == mask)
+            return true;
+        found = first + lowest_bit(mask);
+        return false;
+    });
+    return found;
+}
+
+void q::details::mask_equal(void const* data, std::size_t n, std::size_t width,
+    std::uint64_t pattern, std::uint8_t* mask) noexcept
+{
+    if (0 == n)
+        return;
+    std::memset(mask, 0, n);
+    scan(data, n, width, pattern, pattern, [mask](std::size_t first, std::uint32_t bits) {
+        for (; 0 != bits; bits &= bits - 1)
+            mask[first + lowest_bit(bits)] = 1;
+        return true;
+    });
+}
+
+void q::details::bitmap_equal(void const* data, std::size_t n, std::size_t width,
+    std::uint64_t pattern, std::uint64_t* bitmap) noexcept
+{
+    if (0 == n)
+        return;
+    std::memset(bitmap, 0, (n + 63) / 64 * sizeof(std::uint64_t));
+    scan(data, n, width, pattern, pattern, [bitmap](std::size_t first, std::uint32_t bits) {
+        bitmap[first / 64] |= std::uint64_t{ bits } << (first % 64);
+        return true;
+    });
+}
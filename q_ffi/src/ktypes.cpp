@@ -30,6 +30,7 @@ namespace q
         { kTable, ' ' },
         { kDict, ' ' },
         { kNil, '\0' },
+        { kForeign, '\0' },
         { kError, '\0' }
     };
 
@@ -40,6 +41,21 @@ namespace q
     return TypeTraits<kError>::atom(msg, sys);
 }
 
+std::string q::q2Str(::K const k)
+{
+    switch (type(k))
+    {
+    case -kSymbol:
+        return TypeTraits<kSymbol>::value(k);
+    case -kChar:
+        return std::string(1, TypeTraits<kChar>::value(k));
+    case kChar:
+        return std::string(TypeTraits<kChar>::index(k), count(k));
+    default:
+        throw K_error("type");
+    }
+}
+
 #pragma region *_to_str implementations
 namespace
 {
@@ -79,21 +95,21 @@ namespace
 
     std::string mixed_to_str(::K const k)
     {
-        k,  //VC++: C41000
+        static_cast<void>(k);  //VC++: C4100
         assert(nullptr != k && q::kMixed == q::type(k));
         return "<kMixed>";
     }
 
     std::string table_to_str(::K const k)
     {
-        k,  //VC++: C41000
+        static_cast<void>(k);  //VC++: C4100
         assert(nullptr != k && q::kTable == q::type(k));
         return "<kTable>";
     }
 
     std::string dict_to_str(::K const k)
     {
-        k,  //VC++: C41000
+        static_cast<void>(k);  //VC++: C4100
         assert(nullptr != k && q::kDict == q::type(k));
         return "<kDict>";
     }
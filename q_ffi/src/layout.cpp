@@ -0,0 +1,273 @@
+#include "layout.hpp"
+#include "ktype_traits.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+using q_ffi::Field;
+
+namespace
+{
+    /// @brief Rows transposed at a time, so that a block of structs stays in (half of) the L1 cache.
+    constexpr std::size_t kBlockBytes = 16u * 1024;
+
+    constexpr std::size_t align_up(std::size_t n, std::size_t alignment) noexcept
+    { return (n + alignment - 1) / alignment * alignment; }
+
+    template<q::TypeId tid>
+    void pack_field(Field const& field, ::K column, char* rows, std::size_t stride,
+        std::size_t begin, std::size_t end)
+    {
+        using Traits = q::TypeTraits<tid>;
+        using value_type = typename Traits::value_type;
+        auto const out = rows + field.offset;
+        if (0 == field.extent) {
+            auto const items = Traits::index(column);
+            for (auto i = begin; i < end; ++i)
+                std::memcpy(out + i * stride, items + i, sizeof(value_type));
+            return;
+        }
+
+        auto const cells = q::TypeTraits<q::kMixed>::index(column);
+        for (auto i = begin; i < end; ++i) {
+            auto const cell = cells[i];
+            auto const dst = out + i * stride;
+            std::size_t n = 1;
+            if (0 > q::type(cell))
+                std::memcpy(dst, &Traits::value(cell), sizeof(value_type));
+            else {
+                n = q::count(cell);
+                std::memcpy(dst, Traits::index(cell), n * sizeof(value_type));
+            }
+            std::memset(dst + n * sizeof(value_type), 0, (field.extent - n) * sizeof(value_type));
+        }
+    }
+
+    template<q::TypeId tid>
+    typename q::TypeTraits<tid>::value_type load(char const* src) noexcept
+    {
+        typename q::TypeTraits<tid>::value_type v;
+        std::memcpy(&v, src, sizeof(v));
+        if constexpr (q::kSymbol == tid)
+            return ::ss(const_cast<::S>(nullptr == v ? q::TypeTraits<q::kSymbol>::null() : v));
+        else
+            return v;
+    }
+
+    template<q::TypeId tid>
+    void unpack_field(Field const& field, char const* rows, std::size_t stride, ::K column,
+        std::size_t begin, std::size_t end)
+    {
+        using Traits = q::TypeTraits<tid>;
+        using value_type = typename Traits::value_type;
+        auto const in = rows + field.offset;
+        if (0 == field.extent) {
+            auto const items = Traits::index(column);
+            for (auto i = begin; i < end; ++i)
+                items[i] = load<tid>(in + i * stride);
+            return;
+        }
+
+        auto const cells = q::TypeTraits<q::kMixed>::index(column);
+        for (auto i = begin; i < end; ++i) {
+            auto const src = reinterpret_cast<value_type const*>(in + i * stride);
+            auto n = field.extent;
+            if constexpr (q::kChar == tid)
+                n = ::strnlen(src, n);
+            auto const cell = Traits::list(src, src + n);
+            if constexpr (q::kSymbol == tid) {
+                std::transform(Traits::index(cell), Traits::index(cell) + n, Traits::index(cell),
+                    [](value_type s) { return ::ss(const_cast<::S>(nullptr == s ? Traits::null() : s)); });
+            }
+            cells[i] = cell;
+        }
+    }
+
+    template<q::TypeId tid>
+    Field make_field(char code)
+    {
+        return Field{ "", code, tid, sizeof(typename q::TypeTraits<tid>::value_type), 0, 0,
+            &pack_field<tid>, &unpack_field<tid> };
+    }
+
+    Field field_of(char code)
+    {
+        switch (code)
+        {
+        case 'b': return make_field<q::kBoolean>(code);
+        case 'x': return make_field<q::kByte>(code);
+        case 'h': return make_field<q::kShort>(code);
+        case 'i': return make_field<q::kInt>(code);
+        case 'j': return make_field<q::kLong>(code);
+        case 'e': return make_field<q::kReal>(code);
+        case 'f': return make_field<q::kFloat>(code);
+        case 'c': return make_field<q::kChar>(code);
+        case 's': return make_field<q::kSymbol>(code);
+        case 'p': return make_field<q::kTimestamp>(code);
+        case 'm': return make_field<q::kMonth>(code);
+        case 'd': return make_field<q::kDate>(code);
+        case 'z': return make_field<q::kDatetime>(code);
+        case 'n': return make_field<q::kTimespan>(code);
+        case 'u': return make_field<q::kMinute>(code);
+        case 'v': return make_field<q::kSecond>(code);
+        case 't': return make_field<q::kTime>(code);
+        default:
+            throw q::K_error("field type code '" + std::string(1, code) + "' not supported");
+        }
+    }
+
+    bool is_name_char(char c) noexcept
+    { return std::isalnum(static_cast<unsigned char>(c)) || '_' == c; }
+
+    /// @brief Check a column against its field, before anything gets copied.
+    void validate(Field const& field, ::K column, std::size_t rows)
+    {
+        auto const code = std::string(1, field.code);
+        if (0 == field.extent) {
+            if (field.type_id != q::type(column))
+                throw q::K_error("field '" + field.name + "' expects a list of type '" + code + "'");
+            return;
+        }
+
+        auto const error = "field '" + field.name + "' expects lists of up to "
+            + std::to_string(field.extent) + " items of type '" + code + "'";
+        if (q::kMixed != q::type(column)) {
+            if (0 == rows && field.type_id == q::type(column))
+                return;     // empty column of the item type
+            throw q::K_error(error);
+        }
+        auto const cells = q::TypeTraits<q::kMixed>::index(column);
+        for (std::size_t i = 0; i < rows; ++i) {
+            auto const t = q::type(cells[i]);
+            if ((field.type_id != t && -field.type_id != t) || field.extent < q::count(cells[i]))
+                throw q::K_error(error);
+        }
+    }
+
+}//namespace /*anonymous*/
+
+q_ffi::StructLayout::StructLayout(std::string const& fields)
+    : fields_{}, size_{ 0 }, alignment_{ 1 }
+{
+    auto const n = fields.length();
+    std::size_t pos = 0;
+    while (pos < n) {
+        if (std::isspace(static_cast<unsigned char>(fields[pos])) || ';' == fields[pos]) {
+            ++pos;
+            continue;
+        }
+
+        std::string name;
+        auto end = pos;
+        while (end < n && is_name_char(fields[end]))
+            ++end;
+        if (end < n && ':' == fields[end]) {
+            if (pos == end)
+                throw q::K_error("field name expected before ':'");
+            name = fields.substr(pos, end - pos);
+            pos = end + 1;
+            if (n <= pos)
+                throw q::K_error("type code expected for field '" + name + "'");
+        }
+
+        auto field = field_of(fields[pos++]);
+        end = pos;
+        while (end < n && std::isdigit(static_cast<unsigned char>(fields[end])))
+            ++end;
+        if (pos < end) {
+            field.extent = static_cast<std::size_t>(std::stoull(fields.substr(pos, end - pos)));
+            if (0 == field.extent)
+                throw q::K_error("zero-length array field");
+            pos = end;
+        }
+
+        auto const i = fields_.size();
+        field.name = name.empty() ? (0 == i ? "x" : "x" + std::to_string(i)) : name;
+        field.offset = align_up(size_, field.size);
+        size_ = field.offset + field.width();
+        alignment_ = std::max(alignment_, field.size);
+        fields_.push_back(std::move(field));
+    }
+    if (fields_.empty())
+        throw q::K_error("struct without any field");
+    size_ = align_up(size_, alignment_);
+
+    for (std::size_t i = 1; i < fields_.size(); ++i) {
+        for (std::size_t j = 0; j < i; ++j) {
+            if (fields_[i].name == fields_[j].name)
+                throw q::K_error("duplicate field '" + fields_[i].name + "'");
+        }
+    }
+}
+
+std::string q_ffi::StructLayout::to_str() const
+{
+    std::string str{ "{" };
+    for (auto const& field : fields_) {
+        if (1 < str.size())
+            str += ';';
+        str += field.name;
+        str += ':';
+        str += field.code;
+        if (0 < field.extent)
+            str += std::to_string(field.extent);
+    }
+    str += '}';
+    return str;
+}
+
+std::size_t q_ffi::StructLayout::rows(::K table)
+{
+    auto const t = q::type(table);
+    if (q::kNil == t)
+        return 0;
+    if (q::kTable != t)
+        throw q::K_error("type");
+    auto const columns = kK(table->k)[1];
+    return 0 == q::count(columns) ? 0 : q::count(kK(columns)[0]);
+}
+
+void q_ffi::StructLayout::pack(::K table, void* out) const
+{
+    auto const n = rows(table);
+    if (0 == n)
+        return;
+    auto const columns = kK(table->k)[1];
+    if (fields_.size() != q::count(columns)) {
+        throw q::K_error("table of " + std::to_string(q::count(columns)) + " columns for a struct of "
+            + std::to_string(fields_.size()) + " fields");
+    }
+    auto const cols = kK(columns);
+    for (std::size_t f = 0; f < fields_.size(); ++f)
+        validate(fields_[f], cols[f], n);
+
+    auto const rowsOut = static_cast<char*>(out);
+    auto const block = std::max<std::size_t>(1, kBlockBytes / size_);
+    for (std::size_t begin = 0; begin < n; begin += block) {
+        auto const end = std::min(n, begin + block);
+        for (std::size_t f = 0; f < fields_.size(); ++f)
+            fields_[f].pack(fields_[f], cols[f], rowsOut, size_, begin, end);
+    }
+}
+
+::K q_ffi::StructLayout::unpack(void const* in, std::size_t n) const
+{
+    auto const m = static_cast<::J>(fields_.size());
+    q::K_ptr names{ ::ktn(q::kSymbol, m) };
+    q::K_ptr columns{ ::ktn(q::kMixed, m) };
+    auto const cols = kK(columns.get());
+    for (std::size_t f = 0; f < fields_.size(); ++f) {
+        auto const& field = fields_[f];
+        kS(names.get())[f] = ::ss(const_cast<::S>(field.name.c_str()));
+        cols[f] = ::ktn(0 == field.extent ? field.type_id : q::kMixed, static_cast<::J>(n));
+    }
+
+    auto const rowsIn = static_cast<char const*>(in);
+    auto const block = std::max<std::size_t>(1, kBlockBytes / size_);
+    for (std::size_t begin = 0; begin < n; begin += block) {
+        auto const end = std::min(n, begin + block);
+        for (std::size_t f = 0; f < fields_.size(); ++f)
+            fields_[f].unpack(fields_[f], rowsIn, size_, cols[f], begin, end);
+    }
+    return ::xT(::xD(names.release(), columns.release()));
+}
@@ -0,0 +1,205 @@
+#include "library.hpp"
+#include "ktype_traits.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <iterator>
+#include <utility>
+#if defined(__GLIBC__)
+#   include <link.h>
+#endif
+
+using q_ffi::FunctionPtr;
+using q_ffi::Library;
+
+namespace
+{
+    [[noreturn]] void throw_dlerror()
+    {
+        auto const error = ::dlerror();
+        throw q::K_error(nullptr == error ? "dl" : error);
+    }
+
+    /// @brief Path of the file actually opened by @c dlopen, resolving search paths & links.
+    std::string canonical_path(void* handle, std::string const& path)
+    {
+        if (path.empty())
+            return path;
+        std::string opened{ path };
+#if defined(__GLIBC__)
+        ::link_map* map = nullptr;
+        if (0 == ::dlinfo(handle, RTLD_DI_LINKMAP, &map) && nullptr != map && '\0' != *map->l_name)
+            opened = map->l_name;
+#else
+        static_cast<void>(handle);
+#endif
+#ifndef _WIN32
+        char resolved[PATH_MAX];
+        if (nullptr != ::realpath(opened.c_str(), resolved))
+            opened = resolved;
+#endif
+        return opened;
+    }
+
+    struct Entry
+    {
+        std::weak_ptr<Library> library;
+        std::shared_ptr<Library> pinned;
+    };
+
+    /// @brief Process-wide library cache.
+    struct Cache
+    {
+        std::mutex mutex;
+        /// @brief Libraries by canonical path
+        std::unordered_map<std::string, Entry> entries;
+        /// @brief Canonical paths by requested path
+        std::unordered_map<std::string, std::string> aliases;
+
+        static Cache& instance()
+        {
+            static Cache cache;
+            return cache;
+        }
+
+        /// @return Cached library for @c key (pinning it again if it has been unloaded).
+        std::shared_ptr<Library> find(std::string const& key)
+        {
+            auto const it = entries.find(key);
+            if (entries.cend() == it)
+                return nullptr;
+            auto library = it->second.library.lock();
+            if (nullptr == library)
+                entries.erase(it);
+            else
+                it->second.pinned = library;
+            return library;
+        }
+    };
+
+}//namespace /*anonymous*/
+
+std::shared_ptr<Library> Library::open(std::string const& path, int flags)
+{
+    auto& cache = Cache::instance();
+    std::lock_guard<std::mutex> lock{ cache.mutex };
+
+    auto const alias = cache.aliases.find(path);
+    if (cache.aliases.cend() != alias) {
+        auto library = cache.find(alias->second);
+        if (nullptr != library)
+            return library;
+    }
+
+    void* const handle = ::dlopen(path.empty() ? nullptr : path.c_str(), flags);
+    if (nullptr == handle)
+        throw_dlerror();
+    auto canonical = canonical_path(handle, path);
+    cache.aliases[path] = canonical;
+
+    auto library = cache.find(canonical);
+    if (nullptr != library) {
+        ::dlclose(handle);  // already opened through another path
+        return library;
+    }
+    library.reset(new Library(handle, canonical, flags));
+    cache.entries[canonical] = Entry{ library, library };
+    return library;
+}
+
+bool Library::unload(std::string const& path)
+{
+    auto& cache = Cache::instance();
+    std::shared_ptr<Library> released;
+    {
+        std::lock_guard<std::mutex> lock{ cache.mutex };
+        auto const alias = cache.aliases.find(path);
+        auto const key = cache.aliases.cend() == alias ? path : alias->second;
+        auto const it = cache.entries.find(key);
+        if (cache.entries.cend() == it || nullptr == it->second.pinned)
+            return false;
+        released = std::move(it->second.pinned);
+    }
+    // If this was the last reference, dlclose() happens here, outside of the lock
+    return true;
+}
+
+Library::Library(void* handle, std::string path, int flags) noexcept
+    : handle_{ handle }, path_{ std::move(path) }, flags_{ flags }, mutex_{}, symbols_{}, exports_{}
+{}
+
+Library::~Library()
+{
+    ::dlclose(handle_);
+}
+
+FunctionPtr Library::resolve(std::string const& name)
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    auto const it = symbols_.find(name);
+    if (symbols_.cend() != it)
+        return it->second;
+
+    auto const fn = to_function(::dlsym(handle_, name.c_str()));
+    if (nullptr == fn)
+        throw_dlerror();
+    return symbols_[name] = fn;
+}
+
+std::vector<FunctionPtr> Library::resolve(std::vector<std::string> const& names)
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    std::vector<std::string> missing;
+    for (auto const& name : names) {
+        if (symbols_.cend() == symbols_.find(name))
+            missing.push_back(name);
+    }
+
+    if (!missing.empty()) {
+        std::vector<void*> found(missing.size(), nullptr);
+        try {
+            if (nullptr == exports_)
+                exports_ = std::make_unique<ElfExports>(handle_);
+            found = exports_->find_all(missing);
+        }
+        catch (q::K_error const&) {
+            // Not readable: all through dlsym
+        }
+        for (std::size_t i = 0; i < missing.size(); ++i) {
+            auto fn = to_function(found[i]);
+            if (nullptr == fn)
+                fn = to_function(::dlsym(handle_, missing[i].c_str()));
+            if (nullptr == fn)
+                throw_dlerror();
+            symbols_[missing[i]] = fn;
+        }
+    }
+
+    std::vector<FunctionPtr> fns;
+    fns.reserve(names.size());
+    std::transform(names.cbegin(), names.cend(), std::back_inserter(fns),
+        [this](std::string const& name) { return symbols_[name]; });
+    return fns;
+}
+
+void* Library::find(std::string const& name) noexcept
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    try {
+        if (nullptr == exports_)
+            exports_ = std::make_unique<ElfExports>(handle_);
+        return exports_->find(name.c_str());
+    }
+    catch (std::exception const&) {
+        // Not readable: through dlsym (also searching dependencies)
+        return ::dlsym(handle_, name.c_str());
+    }
+}
+
+q_ffi::ElfExports const& Library::exports()
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (nullptr == exports_)
+        exports_ = std::make_unique<ElfExports>(handle_);
+    return *exports_;
+}
@@ -0,0 +1,361 @@
+#include "marshal.hpp"
+#include "ktype_traits.hpp"
+#include "callback.hpp"
+#include "handle.hpp"
+#include <cctype>
+#include <memory>
+#include <type_traits>
+
+using q_ffi::Marshaler;
+using q_ffi::ParamKind;
+using q_ffi::Scratch;
+using q_ffi::Slot;
+using q_ffi::Storer;
+using q_ffi::Unmarshaler;
+
+namespace
+{
+    template<typename T>
+    Slot to_slot(T v) noexcept
+    {
+        if constexpr (std::is_floating_point_v<T>) {
+            Slot s = 0;
+            std::memcpy(&s, &v, sizeof(v));
+            return s;
+        }
+        else if constexpr (std::is_pointer_v<T>) {
+            return static_cast<Slot>(reinterpret_cast<std::uintptr_t>(v));
+        }
+        else if constexpr (std::is_signed_v<T>) {
+            return static_cast<Slot>(static_cast<std::int64_t>(v));
+        }
+        else {
+            return static_cast<Slot>(v);
+        }
+    }
+
+    template<typename T>
+    T from_slot(Slot s) noexcept
+    {
+        if constexpr (std::is_floating_point_v<T>) {
+            T v;
+            std::memcpy(&v, &s, sizeof(v));   // value is in the low-order bytes
+            return v;
+        }
+        else if constexpr (std::is_pointer_v<T>) {
+            return reinterpret_cast<T>(static_cast<std::uintptr_t>(s));
+        }
+        else {
+            return static_cast<T>(s);
+        }
+    }
+
+    template<q::TypeId tid>
+    Slot marshal(::K arg, std::size_t i, Scratch& /*scratch*/)
+    {
+        using Traits = q::TypeTraits<tid>;
+        switch (q::type(arg))
+        {
+        case -tid:
+            return to_slot(Traits::value(arg));
+        case tid:
+            assert(i < q::count(arg));
+            return to_slot(Traits::index(arg)[i]);
+        default:
+            throw q::K_error("type");
+        }
+    }
+
+    /// @remark Symbols are interned & NUL-terminated already, while strings need a terminated copy
+    ///     (from the scratch arena, so without any heap allocation once warmed up).
+    template<>
+    Slot marshal<q::kSymbol>(::K arg, std::size_t i, Scratch& scratch)
+    {
+        using Traits = q::TypeTraits<q::kSymbol>;
+        switch (q::type(arg))
+        {
+        case -q::kSymbol:
+            return to_slot(Traits::value(arg));
+        case q::kSymbol:
+            assert(i < q::count(arg));
+            return to_slot(Traits::index(arg)[i]);
+        case -q::kChar:
+            return to_slot(scratch.terminate(&q::TypeTraits<q::kChar>::value(arg), 1));
+        case q::kChar:
+            return to_slot(scratch.terminate(
+                q::TypeTraits<q::kChar>::index(arg), static_cast<std::size_t>(q::count(arg))));
+        default:
+            throw q::K_error("type");
+        }
+    }
+
+    /// @brief Pointer to the items of a native buffer of type @c tid.
+    void* buffer_items(::K arg, q::TypeId tid)
+    {
+        auto const& buffer = q_ffi::Handle::from_q(arg);
+        if (tid != buffer.type())
+            throw q::K_error("type");
+        if (nullptr == buffer.get())
+            throw q::K_error("released");
+        return buffer.get();
+    }
+
+    /// @remark Items are passed in place, so only lists of the exact type (or native buffers of that type,
+    ///     see @c Handle::allocate) are accepted. Generic null is passed as a null pointer.
+    template<q::TypeId tid>
+    Slot marshal_pointer(::K arg, std::size_t /*i*/, Scratch& /*scratch*/)
+    {
+        using Traits = q::TypeTraits<tid>;
+        auto const t = q::type(arg);
+        if (tid == t)
+            return to_slot(Traits::index(arg));
+        if (q::kNil == t)
+            return 0;
+        if (q::kForeign == t)
+            return to_slot(buffer_items(arg, tid));
+
+        auto const code = static_cast<char>(std::toupper(q::TypeCode.at(tid)));
+        auto const width = q_ffi::item_size(static_cast<q::TypeId>(t));
+        if (0 < t && 0 < width && sizeof(typename Traits::value_type) != width) {
+            throw q::K_error(std::string("'") + code + "' expects "
+                + std::to_string(sizeof(typename Traits::value_type)) + "-byte items, got "
+                + std::to_string(width) + "-byte items");
+        }
+        throw q::K_error(std::string("'") + code + "' expects a list of the same type");
+    }
+
+    /// @brief Trampoline of a callback (or a null pointer).
+    Slot marshal_callback(::K arg, std::size_t /*i*/, Scratch& /*scratch*/)
+    {
+        if (q::kNil == q::type(arg))
+            return 0;
+        return static_cast<Slot>(reinterpret_cast<std::uintptr_t>(q_ffi::Callback::from_q(arg).pointer()));
+    }
+
+    /// @brief Native pointer held by a handle (or a null pointer).
+    Slot marshal_handle(::K arg, std::size_t /*i*/, Scratch& /*scratch*/)
+    {
+        if (q::kNil == q::type(arg))
+            return 0;
+        auto const pointer = q_ffi::Handle::from_q(arg).get();
+        if (nullptr == pointer)
+            throw q::K_error("released");
+        return to_slot(pointer);
+    }
+
+    /// @brief Item count of a pointer argument (or 0 for a null pointer), or row count of a table.
+    Slot marshal_count(::K arg, std::size_t /*i*/, Scratch& /*scratch*/)
+    {
+        switch (q::type(arg))
+        {
+        case q::kNil:
+            return 0;
+        case q::kForeign:
+            return to_slot(static_cast<std::int64_t>(q_ffi::Handle::from_q(arg).count()));
+        case q::kTable:
+            return to_slot(static_cast<std::int64_t>(q_ffi::StructLayout::rows(arg)));
+        default:
+            return to_slot(static_cast<std::int64_t>(q::count(arg)));
+        }
+    }
+
+    template<q::TypeId tid>
+    ::K unmarshal(Slot res)
+    {
+        using Traits = q::TypeTraits<tid>;
+        return Traits::atom(from_slot<typename Traits::value_type>(res));
+    }
+
+    template<>
+    ::K unmarshal<q::kSymbol>(Slot res)
+    {
+        using Traits = q::TypeTraits<q::kSymbol>;
+        auto const s = from_slot<Traits::value_type>(res);
+        return Traits::atom(nullptr == s ? Traits::null() : s);
+    }
+
+    template<>
+    ::K unmarshal<q::kNil>(Slot /*res*/)
+    {
+        return q::TypeTraits<q::kNil>::atom();
+    }
+
+    /// @brief Handle without a destructor (see @c Binding for handles owning their native objects).
+    ::K unmarshal_handle(Slot res)
+    {
+        return q_ffi::Handle::to_q(std::make_unique<q_ffi::Handle>(from_slot<void*>(res)));
+    }
+
+    template<q::TypeId tid>
+    void store(::K list, std::size_t i, Slot res)
+    {
+        using Traits = q::TypeTraits<tid>;
+        assert(tid == q::type(list) && i < q::count(list));
+        Traits::index(list)[i] = from_slot<typename Traits::value_type>(res);
+    }
+
+    template<>
+    void store<q::kSymbol>(::K list, std::size_t i, Slot res)
+    {
+        using Traits = q::TypeTraits<q::kSymbol>;
+        assert(q::kSymbol == q::type(list) && i < q::count(list));
+        auto const s = from_slot<Traits::value_type>(res);
+        Traits::index(list)[i] = ::ss(const_cast<::S>(nullptr == s ? Traits::null() : s));
+    }
+
+}//namespace /*anonymous*/
+
+std::size_t q_ffi::item_size(q::TypeId tid) noexcept
+{
+    switch (tid)
+    {
+    case q::kBoolean:
+    case q::kByte:
+    case q::kChar:
+        return 1;
+    case q::kShort:
+        return 2;
+    case q::kInt:
+    case q::kReal:
+    case q::kMonth:
+    case q::kDate:
+    case q::kMinute:
+    case q::kSecond:
+    case q::kTime:
+        return 4;
+    case q::kLong:
+    case q::kFloat:
+    case q::kTimestamp:
+    case q::kDatetime:
+    case q::kTimespan:
+    case q::kSymbol:
+        return 8;
+    case q::kGUID:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+#define SELECT_BY_TYPETRAITS(func, tid) \
+    case (tid): \
+        return &func<(tid)>
+
+Marshaler q_ffi::select_marshaler(Parameter const& par)
+{
+    if (ParamKind::kCount == par.kind)
+        return &marshal_count;
+    if (ParamKind::kOutput == par.kind || nullptr != par.layout)
+        return nullptr;
+    if (ParamKind::kPointer == par.kind)
+        return select_pointer_marshaler(par);
+
+    switch (par.type_id)
+    {
+        SELECT_BY_TYPETRAITS(marshal, q::kBoolean);
+        SELECT_BY_TYPETRAITS(marshal, q::kByte);
+        SELECT_BY_TYPETRAITS(marshal, q::kShort);
+        SELECT_BY_TYPETRAITS(marshal, q::kInt);
+        SELECT_BY_TYPETRAITS(marshal, q::kLong);
+        SELECT_BY_TYPETRAITS(marshal, q::kReal);
+        SELECT_BY_TYPETRAITS(marshal, q::kFloat);
+        SELECT_BY_TYPETRAITS(marshal, q::kChar);
+        SELECT_BY_TYPETRAITS(marshal, q::kSymbol);
+        SELECT_BY_TYPETRAITS(marshal, q::kTimestamp);
+        SELECT_BY_TYPETRAITS(marshal, q::kMonth);
+        SELECT_BY_TYPETRAITS(marshal, q::kDate);
+        SELECT_BY_TYPETRAITS(marshal, q::kDatetime);
+        SELECT_BY_TYPETRAITS(marshal, q::kTimespan);
+        SELECT_BY_TYPETRAITS(marshal, q::kMinute);
+        SELECT_BY_TYPETRAITS(marshal, q::kSecond);
+        SELECT_BY_TYPETRAITS(marshal, q::kTime);
+    case q::kForeign:
+        return '&' == par.code ? &marshal_callback : &marshal_handle;
+    default:
+        throw q::K_error("parameter type not supported");
+    }
+}
+
+Marshaler q_ffi::select_pointer_marshaler(Parameter const& par)
+{
+    switch (par.type_id)
+    {
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kBoolean);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kByte);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kShort);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kInt);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kLong);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kReal);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kFloat);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kChar);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kSymbol);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kTimestamp);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kMonth);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kDate);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kDatetime);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kTimespan);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kMinute);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kSecond);
+        SELECT_BY_TYPETRAITS(marshal_pointer, q::kTime);
+    default:
+        throw q::K_error("parameter type not supported");
+    }
+}
+
+Unmarshaler q_ffi::select_unmarshaler(Parameter const& res)
+{
+    switch (res.type_id)
+    {
+        SELECT_BY_TYPETRAITS(unmarshal, q::kNil);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kBoolean);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kByte);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kShort);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kInt);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kLong);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kReal);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kFloat);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kChar);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kSymbol);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kTimestamp);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kMonth);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kDate);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kDatetime);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kTimespan);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kMinute);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kSecond);
+        SELECT_BY_TYPETRAITS(unmarshal, q::kTime);
+    case q::kForeign:
+        return &unmarshal_handle;
+    default:
+        throw q::K_error("result type not supported");
+    }
+}
+
+Storer q_ffi::select_storer(Parameter const& res)
+{
+    switch (res.type_id)
+    {
+    case q::kNil:
+    case q::kForeign:   // no list of handles
+        return nullptr;
+        SELECT_BY_TYPETRAITS(store, q::kBoolean);
+        SELECT_BY_TYPETRAITS(store, q::kByte);
+        SELECT_BY_TYPETRAITS(store, q::kShort);
+        SELECT_BY_TYPETRAITS(store, q::kInt);
+        SELECT_BY_TYPETRAITS(store, q::kLong);
+        SELECT_BY_TYPETRAITS(store, q::kReal);
+        SELECT_BY_TYPETRAITS(store, q::kFloat);
+        SELECT_BY_TYPETRAITS(store, q::kChar);
+        SELECT_BY_TYPETRAITS(store, q::kSymbol);
+        SELECT_BY_TYPETRAITS(store, q::kTimestamp);
+        SELECT_BY_TYPETRAITS(store, q::kMonth);
+        SELECT_BY_TYPETRAITS(store, q::kDate);
+        SELECT_BY_TYPETRAITS(store, q::kDatetime);
+        SELECT_BY_TYPETRAITS(store, q::kTimespan);
+        SELECT_BY_TYPETRAITS(store, q::kMinute);
+        SELECT_BY_TYPETRAITS(store, q::kSecond);
+        SELECT_BY_TYPETRAITS(store, q::kTime);
+    default:
+        throw q::K_error("result type not supported");
+    }
+}
@@ -0,0 +1,166 @@
+#include "prototype.hpp"
+#include "ktype_traits.hpp"
+#include "kpointer.hpp"
+#include "symbols.hpp"
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+using q_ffi::Prototype;
+
+namespace
+{
+    struct Registry
+    {
+        struct Entry
+        {
+            std::weak_ptr<Prototype const> proto;
+            std::vector<std::string> users;
+        };
+
+        /// @brief Recursive, as a prototype failing to be shared is deleted by @c forget within @c intern.
+        std::recursive_mutex mutex;
+        std::map<std::string, Entry> entries;
+
+        /// @remark Never destroyed, as prototypes may be released after static destruction began.
+        static Registry& instance()
+        {
+            static auto const registry = new Registry;
+            return *registry;
+        }
+
+        /// @brief Deleter of interned prototypes, dropping their expired entry along with them,
+        ///     so that the registry does not grow with signatures no longer bound.
+        static void forget(Prototype const* proto) noexcept
+        {
+            std::string key;
+            try {
+                key = proto->signature.to_str();
+            }
+            catch (...) {
+                // Left for Prototype::table to sweep.
+            }
+            delete proto;
+            if (key.empty())
+                return;
+
+            auto& registry = instance();
+            std::lock_guard<std::recursive_mutex> lock{ registry.mutex };
+            auto const entry = registry.entries.find(key);
+            if (registry.entries.end() != entry && entry->second.proto.expired())
+                registry.entries.erase(entry);
+        }
+    };
+
+}//namespace /*anonymous*/
+
+Prototype::Prototype(Signature sig)
+    : signature{ std::move(sig) }, thunk{ select_thunk(signature) }, each_thunk{ select_each_thunk(signature) },
+    invoker{ signature }, marshalers{}, sources{}, outputs{}, structs{}, callbacks{},
+    unmarshaler{ select_unmarshaler(signature.result()) },
+    storer{ q::kSymbol == signature.result().type_id ? &SymbolCache::store : select_storer(signature.result()) }
+{
+    auto const& params = signature.parameters();
+    marshalers.reserve(params.size());
+    sources.reserve(params.size());
+    std::size_t arg = 0;
+    for (auto const& par : params) {
+        marshalers.push_back(select_marshaler(par));
+        sources.push_back(par.is_explicit() ? arg++ : kNoSource);
+    }
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        if (!params[i].is_explicit() && kNoSource != params[i].source)
+            sources[i] = sources[params[i].source];
+        if (ParamKind::kOutput == params[i].kind)
+            outputs.push_back(i);
+        else if (nullptr != params[i].layout)
+            structs.push_back(i);
+        else if ('&' == params[i].code)
+            callbacks.push_back(i);
+    }
+}
+
+std::shared_ptr<Prototype const> Prototype::intern(Signature sig, std::string const& user)
+{
+    auto& registry = Registry::instance();
+    auto key = sig.to_str();
+    std::lock_guard<std::recursive_mutex> lock{ registry.mutex };
+    auto& entry = registry.entries[key];
+    auto proto = entry.proto.lock();
+    if (nullptr == proto) {
+        try {
+            proto = std::shared_ptr<Prototype const>(new Prototype(std::move(sig)), &Registry::forget);
+        }
+        catch (...) {
+            registry.entries.erase(key);
+            throw;
+        }
+        entry.proto = proto;
+        entry.users.clear();
+    }
+    if (!user.empty())
+        entry.users.push_back(user);
+    return proto;
+}
+
+void Prototype::release(Prototype const& proto, std::string const& user) noexcept
+{
+    if (user.empty())
+        return;
+    auto& registry = Registry::instance();
+    std::lock_guard<std::recursive_mutex> lock{ registry.mutex };
+    auto const entry = registry.entries.find(proto.signature.to_str());
+    if (registry.entries.end() == entry)
+        return;
+    auto& users = entry->second.users;
+    auto const u = std::find(users.begin(), users.end(), user);
+    if (users.end() != u)
+        users.erase(u);
+}
+
+char const* Prototype::invoker_kind() const noexcept
+{
+    if (nullptr != thunk)
+        return "thunk";
+    return invoker.is_planned() ? "plan" : "stub";
+}
+
+std::size_t Prototype::registered() noexcept
+{
+    auto& registry = Registry::instance();
+    std::lock_guard<std::recursive_mutex> lock{ registry.mutex };
+    return registry.entries.size();
+}
+
+::K Prototype::table()
+{
+    std::vector<std::shared_ptr<Prototype const>> live;
+    std::vector<std::vector<std::string>> users;
+    {
+        auto& registry = Registry::instance();
+        std::lock_guard<std::recursive_mutex> lock{ registry.mutex };
+        for (auto entry = registry.entries.begin(); entry != registry.entries.end();) {
+            auto proto = entry->second.proto.lock();
+            if (nullptr == proto) {
+                entry = registry.entries.erase(entry);
+                continue;
+            }
+            live.push_back(std::move(proto));
+            users.push_back(entry->second.users);
+            ++entry;
+        }
+    }
+
+    auto const n = static_cast<::J>(live.size());
+    q::K_ptr signatures{ ::ktn(q::kMixed, n) }, ranks{ ::ktn(q::kLong, n) },
+        invokers{ ::ktn(q::kSymbol, n) }, functions{ ::ktn(q::kMixed, n) };
+    for (std::size_t i = 0; i < live.size(); ++i) {
+        kK(signatures.get())[i] = q::TypeTraits<q::kChar>::list(live[i]->signature.to_str());
+        q::TypeTraits<q::kLong>::index(ranks.get())[i] = static_cast<::J>(live[i]->signature.rank());
+        q::TypeTraits<q::kSymbol>::index(invokers.get())[i] = ::ss(const_cast<::S>(live[i]->invoker_kind()));
+        kK(functions.get())[i] = q::TypeTraits<q::kSymbol>::list(users[i].cbegin(), users[i].cend());
+    }
+    q::K_ptr keys{ q::TypeTraits<q::kSymbol>::list({ "signature", "rank", "invoker", "functions" }) };
+    return ::xT(::xD(keys.release(),
+        ::knk(4, signatures.release(), ranks.release(), invokers.release(), functions.release())));
+}
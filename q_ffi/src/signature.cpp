@@ -0,0 +1,274 @@
+#include "signature.hpp"
+#include "ktype_traits.hpp"
+#include <cctype>
+#include <utility>
+
+namespace
+{
+    using q_ffi::NativeClass;
+    using q_ffi::ParamKind;
+    using q_ffi::Parameter;
+
+    template<q::TypeId tid>
+    Parameter make_parameter(NativeClass native)
+    {
+        return Parameter{
+            '\0', tid, native, sizeof(typename q::TypeTraits<tid>::value_type),
+            ParamKind::kValue, q_ffi::kNoSource, 0, nullptr };
+    }
+
+    Parameter parameter_of(char code)
+    {
+        Parameter par{};
+        switch (code)
+        {
+        case ' ':
+            par = Parameter{ ' ', q::kNil, NativeClass::kVoid, 0, ParamKind::kValue, q_ffi::kNoSource, 0, nullptr };
+            break;
+        case '#':
+            par = make_parameter<q::kLong>(NativeClass::kInteger);
+            par.kind = ParamKind::kCount;
+            break;
+        case 'b': par = make_parameter<q::kBoolean>(NativeClass::kInteger); break;
+        case 'x': par = make_parameter<q::kByte>(NativeClass::kInteger); break;
+        case 'h': par = make_parameter<q::kShort>(NativeClass::kInteger); break;
+        case 'i': par = make_parameter<q::kInt>(NativeClass::kInteger); break;
+        case 'j': par = make_parameter<q::kLong>(NativeClass::kInteger); break;
+        case 'e': par = make_parameter<q::kReal>(NativeClass::kSingle); break;
+        case 'f': par = make_parameter<q::kFloat>(NativeClass::kDouble); break;
+        case 'c': par = make_parameter<q::kChar>(NativeClass::kInteger); break;
+        case 's': par = make_parameter<q::kSymbol>(NativeClass::kInteger); break;
+        case 'p': par = make_parameter<q::kTimestamp>(NativeClass::kInteger); break;
+        case 'm': par = make_parameter<q::kMonth>(NativeClass::kInteger); break;
+        case 'd': par = make_parameter<q::kDate>(NativeClass::kInteger); break;
+        case 'z': par = make_parameter<q::kDatetime>(NativeClass::kDouble); break;
+        case 'n': par = make_parameter<q::kTimespan>(NativeClass::kInteger); break;
+        case 'u': par = make_parameter<q::kMinute>(NativeClass::kInteger); break;
+        case 'v': par = make_parameter<q::kSecond>(NativeClass::kInteger); break;
+        case 't': par = make_parameter<q::kTime>(NativeClass::kInteger); break;
+        case '&':
+        case '*':
+            par = make_parameter<q::kForeign>(NativeClass::kInteger);
+            break;
+        default:
+            if (std::isupper(static_cast<unsigned char>(code))) {
+                par = parameter_of(static_cast<char>(std::tolower(static_cast<unsigned char>(code))));
+                par.native = NativeClass::kInteger;
+                par.size = sizeof(void*);
+                par.kind = ParamKind::kPointer;
+                break;
+            }
+            throw q::K_error("type code '" + std::string(1, code) + "' not supported");
+        }
+        par.code = code;
+        return par;
+    }
+
+    /// @brief Parse the struct layout in braces starting at <code>codes[pos]</code>, leaving @c pos at the
+    ///     closing brace.
+    Parameter struct_parameter(std::string const& codes, std::size_t& pos)
+    {
+        assert('{' == codes[pos]);
+        auto const close = codes.find('}', pos);
+        if (std::string::npos == close)
+            throw q::K_error("'}' expected");
+        auto layout = std::make_shared<q_ffi::StructLayout const>(codes.substr(pos + 1, close - pos - 1));
+        pos = close;
+        return Parameter{ '{', q::kTable, NativeClass::kInteger, sizeof(void*),
+            ParamKind::kPointer, q_ffi::kNoSource, 0, std::move(layout) };
+    }
+
+    /// @brief Type code of the native value of @c par.
+    char native_code(Parameter const& par) noexcept
+    {
+        if (q::kTable == par.type_id)
+            return '*';
+        char code;
+        switch (par.type_id)
+        {
+        case q::kTimestamp:
+        case q::kTimespan:
+            code = 'j';
+            break;
+        case q::kMonth:
+        case q::kDate:
+        case q::kMinute:
+        case q::kSecond:
+        case q::kTime:
+            code = 'i';
+            break;
+        case q::kDatetime:
+            code = 'f';
+            break;
+        default:
+            code = ParamKind::kCount == par.kind
+                ? 'j' : static_cast<char>(std::tolower(static_cast<unsigned char>(par.code)));
+            break;
+        }
+        return ParamKind::kPointer == par.kind || ParamKind::kOutput == par.kind
+            ? static_cast<char>(std::toupper(static_cast<unsigned char>(code))) : code;
+    }
+
+}//namespace /*anonymous*/
+
+q_ffi::Signature::Signature(std::string const& resType, std::string const& parTypes)
+    : result_{ parameter_of(resType.empty() ? ' ' : resType[0]) }, params_{}, rank_{ 0 }, codes_{},
+    variadic_{ kNoSource }, open_{ false }
+{
+    if (1 < resType.length())
+        throw q::K_error("only 1 result type expected");
+    if (ParamKind::kValue != result_.kind)
+        throw q::K_error("result type '" + resType + "' not supported");
+
+    params_.reserve(parTypes.length());
+    auto pointer = kNoSource;
+    std::vector<std::size_t> pending;   // counts & outputs before any pointer parameter
+    std::vector<std::pair<std::size_t, std::size_t>> byArg;     // outputs sized by a q argument
+    auto const n = parTypes.length();
+    for (std::size_t pos = 0; pos < n; ++pos) {
+        auto const code = parTypes[pos];
+        if (std::isspace(static_cast<unsigned char>(code)))
+            continue;
+
+        if ('.' == code) {
+            if (is_variadic())
+                throw q::K_error("only one '.' or '...' expected");
+            if (params_.empty())
+                throw q::K_error("variadic arguments need a fixed parameter before them");
+            variadic_ = params_.size();
+            if (0 == parTypes.compare(pos, 3, "...")) {
+                pos += 2;
+                if (std::string::npos != parTypes.find_first_not_of(" \t", pos + 1))
+                    throw q::K_error("'...' must end the parameter list");
+                open_ = true;
+                codes_ += "...";
+                ++rank_;
+            }
+            else {
+                codes_ += '.';
+            }
+            continue;
+        }
+
+        Parameter par{};
+        if ('>' == code) {
+            if (n <= ++pos)
+                throw q::K_error("type code expected after '>'");
+            codes_ += '>';
+            if ('{' == parTypes[pos]) {
+                par = struct_parameter(parTypes, pos);
+                codes_ += par.layout->to_str();
+            }
+            else {
+                auto const item = static_cast<char>(std::toupper(static_cast<unsigned char>(parTypes[pos])));
+                par = parameter_of(item);
+                if (ParamKind::kPointer != par.kind)
+                    throw q::K_error("type code '" + std::string(1, parTypes[pos]) + "' not supported");
+                codes_ += item;
+            }
+            par.kind = ParamKind::kOutput;
+
+            auto const byIndex = pos + 1 < n && '@' == parTypes[pos + 1];
+            auto const digits = pos + 1 + (byIndex ? 1 : 0);
+            auto end = digits;
+            while (end < n && std::isdigit(static_cast<unsigned char>(parTypes[end])))
+                ++end;
+            if (byIndex && digits == end)
+                throw q::K_error("argument index expected after '@'");
+            if (digits < end) {
+                auto const number = static_cast<std::size_t>(std::stoull(parTypes.substr(digits, end - digits)));
+                if (byIndex)
+                    byArg.emplace_back(params_.size(), number);
+                else
+                    par.length = number;
+                codes_ += parTypes.substr(pos + 1, end - pos - 1);
+                pos = end - 1;
+            }
+            else {
+                if (kNoSource == pointer)
+                    pending.push_back(params_.size());
+                par.source = pointer;
+            }
+        }
+        else if ('{' == code) {
+            par = struct_parameter(parTypes, pos);
+            codes_ += par.layout->to_str();
+        }
+        else {
+            par = parameter_of(code);
+            codes_ += code;
+        }
+
+        switch (par.kind)
+        {
+        case ParamKind::kPointer:
+            pointer = params_.size();
+            for (auto const i : pending)
+                params_[i].source = pointer;
+            pending.clear();
+            break;
+        case ParamKind::kCount:
+            if (kNoSource == pointer)
+                pending.push_back(params_.size());
+            par.source = pointer;
+            break;
+        default:
+            break;
+        }
+        if (is_variadic()) {
+            if (!par.is_explicit())
+                throw q::K_error("'#' or '>' not supported among variadic arguments");
+            if (NativeClass::kSingle == par.native)
+                throw q::K_error("'e' is promoted to 'f' among variadic arguments");
+        }
+        if (par.is_explicit())
+            ++rank_;
+        params_.push_back(par);
+    }
+    if (!pending.empty())
+        throw q::K_error("'#' or '>' without any pointer parameter to get the count from");
+
+    for (auto const& [output, arg] : byArg) {
+        if (rank_ <= arg)
+            throw q::K_error("argument index out of range");
+        std::size_t explicits = 0;
+        for (std::size_t i = 0; i < params_.size(); ++i) {
+            if (params_[i].is_explicit() && arg == explicits++) {
+                params_[output].source = i;
+                break;
+            }
+        }
+    }
+}
+
+q_ffi::Signature q_ffi::Signature::with_tail(std::string const& tail) const
+{
+    if (!open_)
+        throw q::K_error("not variadic");
+    return Signature{ std::string(1, result_.code), codes_.substr(0, codes_.size() - 3) + '.' + tail };
+}
+
+std::string q_ffi::Signature::to_str() const
+{
+    std::string str;
+    str.reserve(codes_.size() + 3);
+    str += result_.code;
+    str += '(';
+    str += codes_;
+    str += ')';
+    return str;
+}
+
+std::string q_ffi::Signature::native_str() const
+{
+    std::string str;
+    str.reserve(params_.size() + 3);
+    str += native_code(result_);
+    str += '(';
+    for (std::size_t i = 0; i < fixed(); ++i)
+        str += native_code(params_[i]);
+    if (is_variadic())
+        str += "...";
+    str += ')';
+    return str;
+}
@@ -0,0 +1,179 @@
+#include "stats.hpp"
+#include "ktype_traits.hpp"
+#include "kpointer.hpp"
+#include "marshal.hpp"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+using q_ffi::CallStats;
+
+namespace
+{
+    /// @brief All live instances, in order of creation.
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<CallStats*> all;
+
+        static Registry& instance()
+        {
+            static Registry registry;
+            return registry;
+        }
+    };
+
+    /// @brief Shard index of the calling thread, assigned round-robin on first use.
+    std::size_t shard_index(std::size_t shards) noexcept
+    {
+        static std::atomic<std::size_t> next{ 0 };
+        thread_local auto const index = next.fetch_add(1, std::memory_order_relaxed);
+        return index % shards;
+    }
+
+    template<typename Get>
+    ::K column(std::vector<CallStats::Totals> const& totals, Get get)
+    {
+        q::K_ptr list{ ::ktn(q::kLong, static_cast<::J>(totals.size())) };
+        std::transform(totals.cbegin(), totals.cend(), q::TypeTraits<q::kLong>::index(list.get()),
+            [&get](auto const& t) { return static_cast<::J>(get(t)); });
+        return list.release();
+    }
+
+}//namespace /*anonymous*/
+
+std::atomic<bool> CallStats::enabled_{ false };
+
+CallStats::CallStats(std::string name, bool listed)
+    : name_{ std::move(name) }, shards_{}
+{
+    reset();
+    if (!listed)
+        return;
+    auto& registry = Registry::instance();
+    std::lock_guard<std::mutex> lock{ registry.mutex };
+    registry.all.push_back(this);
+}
+
+CallStats::~CallStats()
+{
+    auto& registry = Registry::instance();
+    std::lock_guard<std::mutex> lock{ registry.mutex };
+    auto const it = std::find(registry.all.begin(), registry.all.end(), this);
+    if (registry.all.end() != it)
+        registry.all.erase(it);
+}
+
+bool CallStats::enable(bool on) noexcept
+{
+    return enabled_.exchange(on, std::memory_order_relaxed);
+}
+
+CallStats::Shard& CallStats::local() noexcept
+{
+    return shards_[shard_index(kShards)];
+}
+
+void CallStats::record(std::uint64_t nanos, std::uint64_t bytes_in, std::uint64_t bytes_out) noexcept
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+    auto& shard = local();
+    shard.calls.fetch_add(1, relaxed);
+    shard.nanos.fetch_add(nanos, relaxed);
+    shard.bytes_in.fetch_add(bytes_in, relaxed);
+    shard.bytes_out.fetch_add(bytes_out, relaxed);
+    auto max = shard.max_nanos.load(relaxed);
+    while (max < nanos && !shard.max_nanos.compare_exchange_weak(max, nanos, relaxed))
+        ;
+}
+
+void CallStats::fail() noexcept
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+    auto& shard = local();
+    shard.calls.fetch_add(1, relaxed);
+    shard.errors.fetch_add(1, relaxed);
+}
+
+CallStats::Totals CallStats::totals() const noexcept
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+    Totals sum{ 0, 0, 0, 0, 0, 0 };
+    for (auto const& shard : shards_) {
+        sum.calls += shard.calls.load(relaxed);
+        sum.nanos += shard.nanos.load(relaxed);
+        sum.max_nanos = std::max(sum.max_nanos, shard.max_nanos.load(relaxed));
+        sum.bytes_in += shard.bytes_in.load(relaxed);
+        sum.bytes_out += shard.bytes_out.load(relaxed);
+        sum.errors += shard.errors.load(relaxed);
+    }
+    return sum;
+}
+
+void CallStats::reset() noexcept
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+    for (auto& shard : shards_) {
+        for (auto* counter : { &shard.calls, &shard.nanos, &shard.max_nanos,
+                &shard.bytes_in, &shard.bytes_out, &shard.errors })
+            counter->store(0, relaxed);
+    }
+}
+
+void CallStats::reset_all() noexcept
+{
+    auto& registry = Registry::instance();
+    std::lock_guard<std::mutex> lock{ registry.mutex };
+    for (auto* stats : registry.all)
+        stats->reset();
+}
+
+std::uint64_t CallStats::payload(::K k) noexcept
+{
+    if (nullptr == k)
+        return 0;
+    auto const t = q::type(k);
+    if (0 > t)
+        return item_size(static_cast<q::TypeId>(-t));
+    switch (t)
+    {
+    case q::kMixed:
+    case q::kDict: {
+        std::uint64_t sum = 0;
+        auto const items = q::TypeTraits<q::kMixed>::index(k);
+        for (std::size_t i = 0; i < static_cast<std::size_t>(q::count(k)); ++i)
+            sum += payload(items[i]);
+        return sum;
+    }
+    case q::kTable:
+        return payload(k->k);
+    default:
+        return static_cast<std::uint64_t>(q::count(k)) * item_size(static_cast<q::TypeId>(t));
+    }
+}
+
+::K CallStats::table()
+{
+    std::vector<std::string> names;
+    std::vector<Totals> totals;
+    {
+        auto& registry = Registry::instance();
+        std::lock_guard<std::mutex> lock{ registry.mutex };
+        for (auto const* stats : registry.all) {
+            names.push_back(stats->name());
+            totals.push_back(stats->totals());
+        }
+    }
+
+    q::K_ptr keys{ q::TypeTraits<q::kSymbol>::list(
+        { "name", "calls", "nanos", "maxNanos", "bytesIn", "bytesOut", "errors" }) };
+    q::K_ptr columns{ ::knk(7,
+        q::TypeTraits<q::kSymbol>::list(names.cbegin(), names.cend()),
+        column(totals, [](Totals const& t) { return t.calls; }),
+        column(totals, [](Totals const& t) { return t.nanos; }),
+        column(totals, [](Totals const& t) { return t.max_nanos; }),
+        column(totals, [](Totals const& t) { return t.bytes_in; }),
+        column(totals, [](Totals const& t) { return t.bytes_out; }),
+        column(totals, [](Totals const& t) { return t.errors; })) };
+    return ::xT(::xD(keys.release(), columns.release()));
+}
@@ -0,0 +1,58 @@
+#include "symbols.hpp"
+#include "ktype_traits.hpp"
+#include "kview.hpp"
+#include <cstring>
+
+using q_ffi::SymbolCache;
+
+namespace
+{
+    std::size_t slot_of(char const* s, std::size_t size) noexcept
+    {
+        // Fibonacci hashing of the address (strings are not aligned, so all bits count)
+        return static_cast<std::size_t>(
+            (static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(s)) * 0x9E3779B97F4A7C15ull) >> 32) % size;
+    }
+
+}//namespace /*anonymous*/
+
+SymbolCache::SymbolCache() noexcept
+    : entries_{}, hits_{ 0 }, misses_{ 0 }
+{}
+
+::S SymbolCache::intern(char const* s) noexcept
+{
+    using Traits = q::TypeTraits<q::kSymbol>;
+    if (nullptr == s)
+        s = Traits::null();
+
+    auto& entry = entries_[slot_of(s, kSize)];
+    if (entry.raw == s && (entry.sym == s || 0 == std::strcmp(entry.sym, s))) {
+        ++hits_;
+        return entry.sym;
+    }
+    ++misses_;
+    entry.raw = s;
+    entry.sym = ::ss(const_cast<::S>(s));
+    return entry.sym;
+}
+
+void SymbolCache::intern(::K list) noexcept
+{
+    for (auto& item : q::KView<q::kSymbol>{ list })
+        item = intern(item);
+}
+
+::K SymbolCache::atom(char const* s) noexcept
+{
+    auto const k = ::ka(-q::kSymbol);
+    q::TypeTraits<q::kSymbol>::value(k) = intern(s);
+    return k;
+}
+
+void SymbolCache::store(::K list, std::size_t i, Slot res) noexcept
+{
+    using Traits = q::TypeTraits<q::kSymbol>;
+    assert(q::kSymbol == q::type(list) && i < q::count(list));
+    Traits::index(list)[i] = reinterpret_cast<Traits::value_type>(static_cast<std::uintptr_t>(res));
+}
@@ -0,0 +1,131 @@
+#include "invoker.hpp"
+#include "ktype_traits.hpp"
+#include <memory>
+
+using q_ffi::CallPlan;
+using q_ffi::FunctionPtr;
+using q_ffi::NativeClass;
+using q_ffi::Slot;
+
+#pragma region System V call engine
+#ifdef q_ffi_SYSV_CALL
+/// @brief Load registers and stack words from @c frame, call @c fn, and store @c rax and @c xmm0
+///     back into <code>frame[0]</code> and <code>frame[kIntRegs]</code> respectively.
+/// @param stackWords Number of words from <code>frame[kStackBase]</code> to be pushed.
+/// @param sseRegs Number of vector registers used, passed in @c al for variadic callees.
+extern "C" void q_ffi_sysv_call(FunctionPtr fn, Slot* frame, std::size_t stackWords, std::size_t sseRegs);
+
+static_assert(CallPlan::kIntRegs * sizeof(Slot) == 48 && CallPlan::kStackBase * sizeof(Slot) == 112,
+    "frame offsets hard-coded below");
+
+asm(R"(
+    .pushsection .text
+    .p2align 4
+    .globl  q_ffi_sysv_call
+    .hidden q_ffi_sysv_call
+    .type   q_ffi_sysv_call, @function
+q_ffi_sysv_call:
+    .cfi_startproc
+    pushq   %rbp
+    .cfi_def_cfa_offset 16
+    .cfi_offset %rbp, -16
+    movq    %rsp, %rbp
+    .cfi_def_cfa_register %rbp
+    pushq   %r12
+    .cfi_offset %r12, -24
+    movq    %rsi, %r12
+    movq    %rdi, %r11
+    movq    %rcx, %rax
+
+    leaq    0(,%rdx,8), %r10
+    subq    %r10, %rsp
+    andq    $-16, %rsp
+    xorl    %r10d, %r10d
+1:
+    cmpq    %rdx, %r10
+    jae     2f
+    movq    112(%r12,%r10,8), %rcx
+    movq    %rcx, (%rsp,%r10,8)
+    incq    %r10
+    jmp     1b
+2:
+    movsd   48(%r12), %xmm0
+    movsd   56(%r12), %xmm1
+    movsd   64(%r12), %xmm2
+    movsd   72(%r12), %xmm3
+    movsd   80(%r12), %xmm4
+    movsd   88(%r12), %xmm5
+    movsd   96(%r12), %xmm6
+    movsd   104(%r12), %xmm7
+    movq    0(%r12), %rdi
+    movq    8(%r12), %rsi
+    movq    16(%r12), %rdx
+    movq    24(%r12), %rcx
+    movq    32(%r12), %r8
+    movq    40(%r12), %r9
+    call    *%r11
+
+    movq    %rax, 0(%r12)
+    movsd   %xmm0, 48(%r12)
+    movq    -8(%rbp), %r12
+    leave
+    .cfi_def_cfa %rsp, 8
+    ret
+    .cfi_endproc
+    .size   q_ffi_sysv_call, .-q_ffi_sysv_call
+    .popsection
+)");
+#endif
+#pragma endregion
+
+CallPlan::CallPlan(Signature const& sig)
+    : layout_{}, intRegs_{ 0 }, sseRegs_{ 0 }, stackWords_{ 0 }, result_{ sig.result().native }
+{
+#ifdef q_ffi_SYSV_CALL
+    auto const& params = sig.parameters();
+    layout_.reserve(params.size());
+    for (auto const& par : params) {
+        if (NativeClass::kInteger == par.native) {
+            layout_.push_back(intRegs_ < kIntRegs ? intRegs_++ : kStackBase + stackWords_++);
+        }
+        else {
+            layout_.push_back(sseRegs_ < kSseRegs ? kIntRegs + sseRegs_++ : kStackBase + stackWords_++);
+        }
+    }
+#else
+    throw q::K_error(sig.is_variadic() ? "nyi" : "too many parameters");
+#endif
+}
+
+Slot CallPlan::operator()(FunctionPtr fn, Slot const* args) const
+{
+#ifdef q_ffi_SYSV_CALL
+    constexpr std::size_t kLocalWords = 16;
+    Slot local[kStackBase + kLocalWords] = {};
+    std::unique_ptr<Slot[]> heap;
+    auto frame = local;
+    if (kLocalWords < stackWords_) {
+        heap.reset(new Slot[kStackBase + stackWords_]());
+        frame = heap.get();
+    }
+
+    auto const n = layout_.size();
+    for (std::size_t i = 0; i < n; ++i)
+        frame[layout_[i]] = args[i];
+
+    q_ffi_sysv_call(fn, frame, stackWords_, sseRegs_);
+    switch (result_)
+    {
+    case NativeClass::kVoid:
+        return 0;
+    case NativeClass::kInteger:
+        return frame[0];
+    default:
+        return frame[kIntRegs];
+    }
+#else
+    static_cast<void>(fn);
+    static_cast<void>(args);
+    throw q::K_error("nyi");
+#endif
+}
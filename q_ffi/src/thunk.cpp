@@ -0,0 +1,243 @@
+#include "thunk.hpp"
+#include "ktype_traits.hpp"
+#include <algorithm>
+#include <array>
+#include <tuple>
+#include <utility>
+
+using q_ffi::FunctionPtr;
+using q_ffi::EachThunk;
+using q_ffi::Thunk;
+
+namespace
+{
+    /// @brief q types (in table order) whose atoms are passed directly by thunks.
+    constexpr q::TypeId kThunkTypes[] = { q::kInt, q::kLong, q::kReal, q::kFloat, q::kSymbol };
+    constexpr std::size_t kThunkTypeCount = std::extent_v<decltype(kThunkTypes)>;
+
+    constexpr std::size_t power(std::size_t base, std::size_t exp) noexcept
+    {
+        return 0 == exp ? 1 : base * power(base, exp - 1);
+    }
+
+    template<q::TypeId tid>
+    struct Native
+    { using type = typename q::TypeTraits<tid>::value_type; };
+
+    template<>
+    struct Native<q::kNil>
+    { using type = void; };
+
+    template<q::TypeId tid>
+    ::K make_atom(typename Native<tid>::type v) noexcept
+    {
+        return q::TypeTraits<tid>::atom(v);
+    }
+
+    /// @remark Left as a native string, to be interned by the caller.
+    template<>
+    ::K make_atom<q::kSymbol>(char const* v) noexcept
+    {
+        auto const k = ::ka(-q::kSymbol);
+        q::TypeTraits<q::kSymbol>::value(k) = v;
+        return k;
+    }
+
+    template<q::TypeId... tids>
+    struct Types
+    {};
+
+    template<q::TypeId tid>
+    void store(::K list, std::size_t i, typename Native<tid>::type v) noexcept
+    {
+        q::TypeTraits<tid>::index(list)[i] = v;
+    }
+
+    template<q::TypeId res, typename Pars, typename Seq>
+    struct ThunkOf;
+
+    template<q::TypeId res, q::TypeId... pars, std::size_t... I>
+    struct ThunkOf<res, Types<pars...>, std::index_sequence<I...>>
+    {
+        using Fn = typename Native<res>::type (*)(typename Native<pars>::type...);
+
+        static bool call(FunctionPtr fn, ::K const* args, ::K& result)
+        {
+            static_cast<void>(args);
+            if (!((-pars == q::type(args[I])) && ...))
+                return false;
+
+            auto const f = reinterpret_cast<Fn>(fn);
+            if constexpr (q::kNil == res) {
+                f(q::TypeTraits<pars>::value(args[I])...);
+                result = q::TypeTraits<q::kNil>::atom();
+            }
+            else {
+                result = make_atom<res>(f(q::TypeTraits<pars>::value(args[I])...));
+            }
+            return true;
+        }
+
+        /// @remark Atoms are broadcast by reading them with a zero stride.
+        static void each(FunctionPtr fn, ::K const* args, ::K result, std::size_t begin, std::size_t end)
+        {
+            static_cast<void>(args);
+            std::tuple<typename Native<pars>::type const*...> const data{
+                (0 < q::type(args[I]) ? q::TypeTraits<pars>::index(args[I]) : &q::TypeTraits<pars>::value(args[I]))... };
+            std::size_t const stride[] = { (0 < q::type(args[I]) ? 1u : 0u)..., 0u };
+            static_cast<void>(data);
+            static_cast<void>(stride);
+            static_cast<void>(result);
+
+            auto const f = reinterpret_cast<Fn>(fn);
+            for (std::size_t i = begin; i < end; ++i) {
+                if constexpr (q::kNil == res)
+                    f(std::get<I>(data)[i * stride[I]]...);
+                else
+                    store<res>(result, i, f(std::get<I>(data)[i * stride[I]]...));
+            }
+        }
+    };
+
+    template<typename Fn>
+    struct Pick;
+
+    template<>
+    struct Pick<Thunk>
+    {
+        template<typename T>
+        static constexpr Thunk from() noexcept
+        { return &T::call; }
+    };
+
+    template<>
+    struct Pick<EachThunk>
+    {
+        template<typename T>
+        static constexpr EachThunk from() noexcept
+        { return &T::each; }
+    };
+
+    /// @brief Thunk whose parameter @c i is of type <code>kThunkTypes[idx / 5^i % 5]</code>.
+    template<typename Fn, q::TypeId res, std::size_t idx, std::size_t... I>
+    constexpr Fn mixed_thunk(std::index_sequence<I...> seq) noexcept
+    {
+        return Pick<Fn>::template from<ThunkOf<res,
+            Types<kThunkTypes[idx / power(kThunkTypeCount, I) % kThunkTypeCount]...>,
+            decltype(seq)>>();
+    }
+
+    template<typename Fn, q::TypeId res, std::size_t N, std::size_t... idx>
+    constexpr auto make_mixed_thunks(std::index_sequence<idx...>) noexcept
+    {
+        return std::array<Fn, sizeof...(idx)>{ mixed_thunk<Fn, res, idx>(std::make_index_sequence<N>())... };
+    }
+
+    template<typename Fn, q::TypeId res, std::size_t N>
+    Fn mixed_thunk_of(std::size_t idx) noexcept
+    {
+        static constexpr auto thunks =
+            make_mixed_thunks<Fn, res, N>(std::make_index_sequence<power(kThunkTypeCount, N)>());
+        return thunks[idx];
+    }
+
+    template<typename Fn, q::TypeId res, std::size_t... N>
+    Fn mixed_thunk_of(std::size_t n, std::size_t idx, std::index_sequence<N...>) noexcept
+    {
+        static constexpr Fn (*lookup[])(std::size_t) = { &mixed_thunk_of<Fn, res, N>... };
+        return lookup[n](idx);
+    }
+
+    /// @brief Thunk with all @c N parameters of type <code>kThunkTypes[idx]</code>.
+    template<typename Fn, q::TypeId res, std::size_t N, std::size_t... idx>
+    constexpr auto make_uniform_thunks(std::index_sequence<idx...>) noexcept
+    {
+        return std::array<Fn, sizeof...(idx)>{
+            mixed_thunk<Fn, res, idx * (power(kThunkTypeCount, N) - 1) / (kThunkTypeCount - 1)>(
+                std::make_index_sequence<N>())... };
+    }
+
+    template<typename Fn, q::TypeId res, std::size_t N>
+    Fn uniform_thunk_of(std::size_t idx) noexcept
+    {
+        static constexpr auto thunks =
+            make_uniform_thunks<Fn, res, N>(std::make_index_sequence<kThunkTypeCount>());
+        return thunks[idx];
+    }
+
+    template<typename Fn, q::TypeId res, std::size_t... N>
+    Fn uniform_thunk_of(std::size_t n, std::size_t idx, std::index_sequence<N...>) noexcept
+    {
+        static constexpr Fn (*lookup[])(std::size_t) = { &uniform_thunk_of<Fn, res, N>... };
+        return lookup[n](idx);
+    }
+
+    template<typename Fn, q::TypeId res>
+    Fn thunk_of(std::size_t n, std::size_t idx, bool uniform) noexcept
+    {
+        using namespace q_ffi;
+        if (n <= kMaxMixedThunkArgs)
+            return mixed_thunk_of<Fn, res>(n, idx, std::make_index_sequence<kMaxMixedThunkArgs + 1>());
+        else if (uniform && n <= kMaxCallArgs)
+            return uniform_thunk_of<Fn, res>(n, idx % kThunkTypeCount, std::make_index_sequence<kMaxCallArgs + 1>());
+        else
+            return nullptr;
+    }
+
+    /// @return Position in @c kThunkTypes, or @c kThunkTypeCount if not found.
+    std::size_t index_of(q_ffi::Parameter const& par) noexcept
+    {
+        if (q_ffi::ParamKind::kValue != par.kind)
+            return kThunkTypeCount;
+        auto const p = std::find(std::cbegin(kThunkTypes), std::cend(kThunkTypes), par.type_id);
+        return static_cast<std::size_t>(std::distance(std::cbegin(kThunkTypes), p));
+    }
+
+    template<typename Fn>
+    Fn select(q_ffi::Signature const& sig) noexcept
+    {
+        if (sig.is_variadic())
+            return nullptr;
+        auto const& params = sig.parameters();
+        std::size_t idx = 0, scale = 1;
+        bool uniform = true;
+        for (auto const& par : params) {
+            auto const i = index_of(par);
+            if (kThunkTypeCount <= i)
+                return nullptr;
+            uniform = uniform && (par.type_id == params.front().type_id);
+            idx += i * scale;
+            scale *= kThunkTypeCount;
+        }
+
+        auto const n = params.size();
+        switch (sig.result().type_id)
+        {
+        case q::kNil:
+            return thunk_of<Fn, q::kNil>(n, idx, uniform);
+        case q::kInt:
+            return thunk_of<Fn, q::kInt>(n, idx, uniform);
+        case q::kLong:
+            return thunk_of<Fn, q::kLong>(n, idx, uniform);
+        case q::kReal:
+            return thunk_of<Fn, q::kReal>(n, idx, uniform);
+        case q::kFloat:
+            return thunk_of<Fn, q::kFloat>(n, idx, uniform);
+        case q::kSymbol:
+            return thunk_of<Fn, q::kSymbol>(n, idx, uniform);
+        default:
+            return nullptr;
+        }
+    }
+
+}//namespace /*anonymous*/
+
+Thunk q_ffi::select_thunk(Signature const& sig) noexcept
+{
+    return select<Thunk>(sig);
+}
+
+EachThunk q_ffi::select_each_thunk(Signature const& sig) noexcept
+{
+    return select<EachThunk>(sig);
+}
@@ -0,0 +1,119 @@
+#include "workers.hpp"
+#include <algorithm>
+#include <utility>
+
+using q_ffi::WorkerPool;
+
+WorkerPool& WorkerPool::instance()
+{
+    static WorkerPool pool{ std::max(std::thread::hardware_concurrency(), 1u) - 1u };
+    return pool;
+}
+
+WorkerPool::WorkerPool(std::size_t workers)
+    : run_{}, mutex_{}, wake_{}, done_{}, threads_{}, stopping_{ false },
+    task_{ nullptr }, total_{ 0 }, chunk_{ 0 }, chunks_{ 0 }, next_{ 0 }, remaining_{ 0 }, error_{}
+{
+    start(workers);
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+std::size_t WorkerPool::size() const
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    return threads_.size();
+}
+
+void WorkerPool::resize(std::size_t workers)
+{
+    std::lock_guard<std::mutex> running{ run_ };
+    stop();
+    start(workers);
+}
+
+void WorkerPool::run(std::size_t n, std::size_t grain, Task const& task)
+{
+    std::lock_guard<std::mutex> running{ run_ };
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    auto const chunks = std::min(threads_.size() + 1, n / std::max<std::size_t>(grain, 1));
+    if (chunks <= 1) {
+        lock.unlock();
+        task(0, n);
+        return;
+    }
+
+    task_ = &task;
+    total_ = n;
+    chunk_ = (n + chunks - 1) / chunks;
+    chunks_ = chunks;
+    next_ = 0;
+    remaining_ = chunks;
+    error_ = nullptr;
+    wake_.notify_all();
+
+    work(lock);
+    done_.wait(lock, [this] { return 0 == remaining_; });
+    task_ = nullptr;
+    if (error_)
+        std::rethrow_exception(std::exchange(error_, nullptr));
+}
+
+void WorkerPool::start(std::size_t workers)
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    stopping_ = false;
+    threads_.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i)
+        threads_.emplace_back(&WorkerPool::loop, this);
+}
+
+void WorkerPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock{ mutex_ };
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : threads_)
+        t.join();
+    threads_.clear();
+}
+
+void WorkerPool::loop()
+{
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    for (;;) {
+        wake_.wait(lock, [this] { return stopping_ || (nullptr != task_ && next_ < chunks_); });
+        if (stopping_)
+            return;
+        work(lock);
+    }
+}
+
+void WorkerPool::work(std::unique_lock<std::mutex>& lock)
+{
+    while (next_ < chunks_) {
+        auto const begin = chunk_ * next_++;
+        auto const end = std::min(total_, begin + chunk_);
+        auto const task = task_;
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            (*task)(begin, end);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        if (error && !error_)
+            error_ = error;
+        if (0 == --remaining_)
+            done_.notify_all();
+    }
+}
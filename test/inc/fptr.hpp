@@ -0,0 +1,13 @@
+#pragma once
+
+#include "invoker.hpp"
+
+namespace q_ffi
+{
+
+/// @brief Any C/C++ function, as the untyped pointer taken by bindings and invokers.
+template<typename Fn>
+FunctionPtr fptr(Fn* fn) noexcept
+{ return reinterpret_cast<FunctionPtr>(fn); }
+
+}//namespace q_ffi
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "ktype_traits.hpp"
+#include "kpointer.hpp"
+#include "arena.hpp"
+#include "binding.hpp"
+#include "fptr.hpp"
+#include <cstring>
+
+namespace
+{
+    std::size_t length(char const* s)
+    { return std::strlen(s); }
+
+}//namespace /*anonymous*/
+
+namespace q_ffi
+{
+    using namespace q;
+
+    TEST(ArenaTests, rewind)
+    {
+        Arena arena{ 64 };
+        auto const start = arena.mark();
+        auto const a = static_cast<char*>(arena.allocate(10, 1));
+        std::memset(a, 'a', 10);
+        auto const b = arena.allocate(8, 16);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(b) % 16, 0u);
+        EXPECT_EQ(static_cast<char const*>(b)[7], '\0') << "zero-filled";
+
+        auto const big = arena.allocate(1000, 8);
+        EXPECT_NE(big, nullptr);
+        auto const capacity = arena.capacity();
+        EXPECT_LE(1000u + 64u, capacity);
+
+        arena.rewind(start);
+        EXPECT_EQ(arena.allocate(10, 1), a) << "memory reused";
+        EXPECT_EQ(a[0], '\0');
+        arena.allocate(1000, 8);
+        EXPECT_EQ(arena.capacity(), capacity) << "blocks reused";
+
+        arena.rewind(start);
+        arena.allocate(Arena::kMaxRetained * 2, 8);
+        arena.rewind(start);
+        EXPECT_EQ(arena.capacity(), capacity) << "oversized blocks released";
+    }
+
+    TEST(ArenaTests, nested)
+    {
+        Arena arena{ 64 };
+        Scratch outer{ arena };
+        auto const s = outer.terminate("hello", 3);
+        EXPECT_STREQ(s, "hel");
+        {
+            Scratch inner{ arena };
+            EXPECT_STREQ(inner.terminate("world", 5), "world");
+        }
+        EXPECT_STREQ(s, "hel") << "outer temporaries kept";
+        EXPECT_EQ(outer.terminate("", 0), s + 4) << "inner temporaries released";
+    }
+
+    TEST(ArenaTests, strings)
+    {
+        Binding len{ fptr(&length), Signature("j", "s") };
+        K_ptr str{ TypeTraits<kChar>::list("hello world") };
+        ::K args[] = { str.get() };
+        auto& local = Arena::local();
+        K_ptr r{ len(args) };
+        ASSERT_EQ(type(r.get()), -kLong);
+        EXPECT_EQ(TypeTraits<kLong>::value(r.get()), 11);
+
+        auto const capacity = local.capacity();
+        auto const mark = local.mark();
+        r.reset(len(args));
+        EXPECT_EQ(local.capacity(), capacity) << "steady state without allocations";
+        EXPECT_EQ(local.mark().used, mark.used) << "released after the call";
+
+        K_ptr sym{ TypeTraits<kSymbol>::atom("symbol") };
+        args[0] = sym.get();
+        r.reset(len(args));
+        EXPECT_EQ(TypeTraits<kLong>::value(r.get()), 6);
+    }
+
+}//namespace q_ffi
@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+#include "ktype_traits.hpp"
+#include "kpointer.hpp"
+#include "binding.hpp"
+#include "callback.hpp"
+#include "async.hpp"
+#include "fptr.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+
+namespace
+{
+    /// @brief Stand-ins for q functions: a long atom indexing into this list.
+    std::vector<std::function<::K(::K)>> lambdas;
+
+    ::K lambda(std::function<::K(::K)> fn)
+    {
+        lambdas.push_back(std::move(fn));
+        return q::TypeTraits<q::kLong>::atom(static_cast<::J>(lambdas.size() - 1));
+    }
+
+    double integrate(double (*f)(double), double a, double b, std::int64_t n)
+    {
+        auto const h = (b - a) / static_cast<double>(n);
+        double sum = 0.;
+        for (std::int64_t i = 0; i < n; ++i)
+            sum += f(a + (static_cast<double>(i) + .5) * h) * h;
+        return sum;
+    }
+
+    void ticks(void (*on_tick)(double, std::int64_t), std::int64_t n)
+    {
+        for (std::int64_t i = 0; i < n; ++i)
+            on_tick(static_cast<double>(i) / 2, i);
+    }
+
+    double apply_off_thread(double (*f)(double), double x)
+    {
+        double result = -1.;
+        std::thread{ [&] { result = f(x); } }.join();
+        return result;
+    }
+
+    std::thread::id worker;
+
+    double slow_add(double a, double b)
+    {
+        worker = std::this_thread::get_id();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return a + b;
+    }
+
+    void square_all(double const* in, double* out, std::int64_t n)
+    {
+        for (std::int64_t i = 0; i < n; ++i)
+            out[i] = in[i] * in[i];
+    }
+
+}//namespace /*anonymous*/
+
+/// @brief q's <code>.</code>, as exported by the q executable hosting the library.
+::K dot(::K function, ::K args)
+{
+    return lambdas.at(static_cast<std::size_t>(q::TypeTraits<q::kLong>::value(function)))(args);
+}
+
+namespace q_ffi
+{
+    using namespace q;
+
+#ifdef q_ffi_SYSV_CALL
+    TEST(CallbackTests, comparator)
+    {
+        K_ptr fn{ lambda([](::K args) {
+            auto const lhs = TypeTraits<kFloat>::value(kK(args)[0]);
+            auto const rhs = TypeTraits<kFloat>::value(kK(args)[1]);
+            return TypeTraits<kInt>::atom(lhs < rhs ? -1 : rhs < lhs ? 1 : 0);
+        }) };
+        Callback cmp{ fn.get(), Signature("i", "FF") };
+        using Compare = int (*)(void const*, void const*);
+        double values[] = { 3., -1., 2.5, 0., 10., -7.25 };
+        std::qsort(values, 6, sizeof(double), reinterpret_cast<Compare>(cmp.pointer()));
+        EXPECT_TRUE(std::is_sorted(std::begin(values), std::end(values)));
+    }
+
+    TEST(CallbackTests, pool)
+    {
+        K_ptr fn{ lambda([](::K) { return TypeTraits<kNil>::atom(); }) };
+        std::vector<std::unique_ptr<Callback>> all;
+        for (std::size_t i = 0; i < kMaxCallbacks; ++i)
+            all.push_back(std::make_unique<Callback>(fn.get(), Signature(" ", "j")));
+        EXPECT_NE(all.front()->pointer(), all.back()->pointer());
+        EXPECT_THROW(Callback(fn.get(), Signature(" ", "j")), K_error);
+
+        auto const reused = all.back()->pointer();
+        all.pop_back();
+        EXPECT_EQ(Callback(fn.get(), Signature(" ", "j")).pointer(), reused);
+
+        EXPECT_THROW(Callback(fn.get(), Signature(" ", "F#")), K_error);
+        EXPECT_THROW(Callback(fn.get(), Signature("j", "j"), 16), K_error);
+    }
+
+    TEST(CallbackTests, binding)
+    {
+        K_ptr fn{ lambda([](::K args) {
+            auto const v = TypeTraits<kFloat>::value(kK(args)[0]);
+            return TypeTraits<kFloat>::atom(v * v);
+        }) };
+        K_ptr square{ Callback::to_q(std::make_unique<Callback>(fn.get(), Signature("f", "f"))) };
+        Binding integral{ fptr(&integrate), Signature("f", "&ffj") };
+        K_ptr a{ TypeTraits<kFloat>::atom(0.) }, b{ TypeTraits<kFloat>::atom(3.) };
+        K_ptr n{ TypeTraits<kLong>::atom(1000) };
+        ::K args[] = { square.get(), a.get(), b.get(), n.get() };
+        K_ptr r{ integral(args) };
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_NEAR(TypeTraits<kFloat>::value(r.get()), 9., 1e-4);
+
+        K_ptr failing{ lambda([](::K) { return TypeTraits<kError>::atom("boom"); }) };
+        K_ptr broken{ Callback::to_q(std::make_unique<Callback>(failing.get(), Signature("f", "f"))) };
+        args[0] = broken.get();
+        EXPECT_THROW(K_ptr(integral(args)), K_error);
+        EXPECT_NO_THROW(Callback::check()) << "error reported once";
+    }
+
+    TEST(CallbackTests, threads)
+    {
+        int calls = 0;
+        K_ptr fn{ lambda([&](::K args) {
+            ++calls;
+            return ::r1(kK(args)[0]);
+        }) };
+        Callback identity{ fn.get(), Signature("f", "f") };
+        auto const f = reinterpret_cast<double (*)(double)>(identity.pointer());
+        EXPECT_DOUBLE_EQ(f(2.5), 2.5);
+        EXPECT_DOUBLE_EQ(apply_off_thread(f, 2.5), 0.) << "zero result off the main thread";
+        EXPECT_EQ(calls, 1) << "q function not evaluated";
+        EXPECT_THROW(Callback::check(), K_error);
+        EXPECT_NO_THROW(Callback::check());
+    }
+
+    TEST(CallbackTests, batched)
+    {
+        std::vector<std::size_t> batches;
+        double sum = 0.;
+        K_ptr fn{ lambda([&](::K args) {
+            batches.push_back(count(kK(args)[0]));
+            EXPECT_EQ(type(kK(args)[0]), kFloat);
+            EXPECT_EQ(type(kK(args)[1]), kLong);
+            for (std::size_t i = 0; i < count(kK(args)[0]); ++i)
+                sum += kF(kK(args)[0])[i] * static_cast<double>(kJ(kK(args)[1])[i]);
+            return TypeTraits<kNil>::atom();
+        }) };
+        K_ptr onTick{ Callback::to_q(std::make_unique<Callback>(fn.get(), Signature(" ", "fj"), 4)) };
+        Binding run{ fptr(&ticks), Signature(" ", "&j") };
+        K_ptr n{ TypeTraits<kLong>::atom(10) };
+        ::K args[] = { onTick.get(), n.get() };
+        K_ptr r{ run(args) };
+        EXPECT_EQ(batches, (std::vector<std::size_t>{ 4, 4, 2 })) << "remaining calls flushed on return";
+        EXPECT_DOUBLE_EQ(sum, 142.5);
+    }
+#endif
+
+#ifdef __linux__
+    TEST(AsyncTests, post)
+    {
+        std::vector<double> results;
+        K_ptr fn{ lambda([&](::K args) {
+            EXPECT_EQ(type(kK(args)[0]), -kFloat);
+            results.push_back(TypeTraits<kFloat>::value(kK(args)[0]));
+            return TypeTraits<kNil>::atom();
+        }) };
+        K_ptr add{ Binding::to_q(std::make_unique<Binding>(fptr(&slow_add), Signature("f", "ff"))) };
+        K_ptr args{ TypeTraits<kFloat>::list({ 1., 2. }) };
+        auto& queue = AsyncQueue::instance();
+        Binding::post(add.get(), args.get(), fn.get());
+        args.reset(::knk(2, TypeTraits<kFloat>::atom(3.), TypeTraits<kFloat>::atom(4.)));
+        Binding::post(add.get(), args.get(), fn.get());
+        EXPECT_EQ(queue.pending(), 2u);
+        EXPECT_TRUE(results.empty()) << "returned before completion";
+
+        add.reset();    // kept alive by the pending calls
+        EXPECT_EQ(queue.drain(true), 2u);
+        EXPECT_EQ(queue.pending(), 0u);
+        EXPECT_EQ(results, (std::vector<double>{ 3., 7. }));
+        EXPECT_NE(worker, std::this_thread::get_id());
+        EXPECT_FALSE(queue.is_registered()) << "not running inside q";
+    }
+
+    TEST(AsyncTests, outputs)
+    {
+        K_ptr squares{ TypeTraits<kNil>::atom() };
+        K_ptr fn{ lambda([&](::K args) {
+            squares.reset(::r1(kK(args)[0]));
+            return TypeTraits<kNil>::atom();
+        }) };
+        K_ptr square{ Binding::to_q(std::make_unique<Binding>(fptr(&square_all), Signature(" ", "F>F#"))) };
+        K_ptr args{ ::knk(1, TypeTraits<kFloat>::list({ 1., 2., 3. })) };
+        Binding::post(square.get(), args.get(), fn.get());
+        EXPECT_EQ(AsyncQueue::instance().drain(true), 1u);
+        ASSERT_EQ(type(squares.get()), kFloat);
+        ASSERT_EQ(count(squares.get()), 3u);
+        EXPECT_DOUBLE_EQ(kF(squares.get())[2], 9.);
+
+        K_ptr each{ TypeTraits<kFloat>::list({ 1., 2. }) };
+        K_ptr add{ Binding::to_q(std::make_unique<Binding>(fptr(&slow_add), Signature("f", "ff"))) };
+        args.reset(::knk(2, each.release(), TypeTraits<kFloat>::atom(1.)));
+        EXPECT_THROW(Binding::post(add.get(), args.get(), fn.get()), K_error);
+    }
+#endif
+
+}//namespace q_ffi
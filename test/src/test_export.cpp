@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include "ktype_traits.hpp"
+#include "kpointer.hpp"
+#include "export_fn.hpp"
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <dlfcn.h>
+
+namespace
+{
+    double add(std::int64_t a, double b) noexcept
+    { return static_cast<double>(a) + b; }
+
+    double inner(q_ffi::span<double const> lhs, q_ffi::span<double const> rhs)
+    {
+        if (lhs.size() != rhs.size())
+            throw q::K_error("length");
+        return std::inner_product(lhs.begin(), lhs.end(), rhs.begin(), 0.);
+    }
+
+    std::vector<std::int32_t> lengths(q_ffi::span<char const* const> names)
+    {
+        std::vector<std::int32_t> result;
+        for (auto const name : names)
+            result.push_back(static_cast<std::int32_t>(std::strlen(name)));
+        return result;
+    }
+
+    int calls = 0;
+
+    void touch()
+    { ++calls; }
+
+    char const* pick(bool first)
+    {
+        if (!first)
+            throw std::invalid_argument("second");
+        return "first";
+    }
+
+    char const* none() noexcept
+    { return nullptr; }
+
+    ::K count_of(::K list) noexcept
+    { return q::TypeTraits<q::kLong>::atom(static_cast<::J>(q::count(list))); }
+
+}//namespace /*anonymous*/
+
+q_ffi_EXPORT(q_ffi_test_inner, &inner, 2)
+q_ffi_EXPORT(q_ffi_test_touch, &touch, 0)
+
+namespace q_ffi
+{
+    using namespace q;
+
+    TEST(ExportTests, atoms)
+    {
+        static_assert(ktype_v<std::int64_t> == kLong && ktype_v<long long> == kLong);
+        static_assert(ktype_v<char const*> == kSymbol && ktype_v<void*> == kNil);
+        static_assert(rank_v<&add> == 2 && rank_v<&touch> == 0);
+
+        constexpr ::K (*wrapper)(::K, ::K) = export_fn<&add>();
+        K_ptr a{ TypeTraits<kLong>::atom(2) }, b{ TypeTraits<kFloat>::atom(.5) };
+        K_ptr r{ wrapper(a.get(), b.get()) };
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 2.5);
+        EXPECT_EQ(wrapper(b.get(), a.get()), Nil) << "no coercion";
+
+        calls = 0;
+        r.reset(export_fn<&touch>()(Nil));
+        EXPECT_EQ(calls, 1);
+        EXPECT_EQ(type(r.get()), kNil);
+
+        K_ptr yes{ TypeTraits<kBoolean>::atom(true) }, no{ TypeTraits<kBoolean>::atom(false) };
+        r.reset(export_fn<&pick>()(yes.get()));
+        ASSERT_EQ(type(r.get()), -kSymbol);
+        EXPECT_STREQ(TypeTraits<kSymbol>::value(r.get()), "first");
+        EXPECT_EQ(export_fn<&pick>()(no.get()), Nil) << "exception reported";
+        r.reset(export_fn<&none>()(Nil));
+        ASSERT_EQ(type(r.get()), -kSymbol);
+        EXPECT_STREQ(TypeTraits<kSymbol>::value(r.get()), "") << "null symbol";
+    }
+
+    TEST(ExportTests, lists)
+    {
+        K_ptr x{ TypeTraits<kFloat>::list({ 1., 2., 3. }) }, y{ TypeTraits<kFloat>::list({ 4., 5., 6. }) };
+        K_ptr r{ export_fn<&inner>()(x.get(), y.get()) };
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 32.);
+        K_ptr z{ TypeTraits<kFloat>::list({ 1. }) };
+        EXPECT_EQ(export_fn<&inner>()(x.get(), z.get()), Nil);
+        K_ptr j{ TypeTraits<kLong>::list({ 1, 2, 3 }) };
+        EXPECT_EQ(export_fn<&inner>()(x.get(), j.get()), Nil);
+
+        K_ptr names{ TypeTraits<kSymbol>::list({ "a", "bcd", "" }) };
+        r.reset(export_fn<&lengths>()(names.get()));
+        ASSERT_EQ(type(r.get()), kInt);
+        ASSERT_EQ(count(r.get()), 3u);
+        EXPECT_EQ(TypeTraits<kInt>::index(r.get())[1], 3);
+
+        r.reset(export_fn<&count_of>()(names.get()));
+        EXPECT_EQ(TypeTraits<kLong>::value(r.get()), 3);
+    }
+
+    TEST(ExportTests, symbol)
+    {
+        using Inner = ::K (*)(::K, ::K);
+        auto const qinner = reinterpret_cast<Inner>(::dlsym(RTLD_DEFAULT, "q_ffi_test_inner"));
+        ASSERT_NE(qinner, nullptr) << "exported for 2:";
+        K_ptr x{ TypeTraits<kFloat>::list({ 1., 2. }) };
+        K_ptr r{ qinner(x.get(), x.get()) };
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 5.);
+
+        calls = 0;
+        K_ptr none{ q_ffi_test_touch(Nil) };
+        EXPECT_EQ(calls, 1);
+    }
+
+}//namespace q_ffi
@@ -0,0 +1,1092 @@
+#include <gtest/gtest.h>
+#include "ktype_traits.hpp"
+#include "kpointer.hpp"
+#include "binding.hpp"
+#include "workers.hpp"
+#include "signature_of.hpp"
+#include "handle.hpp"
+#include "ffi.h"
+#include "fptr.hpp"
+#include <cstdarg>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <string_view>
+
+namespace
+{
+    double add_ff(double x, double y)
+    { return x + y; }
+
+    std::int64_t neg_j(std::int64_t x)
+    { return -x; }
+
+    float mul_ei(float x, std::int32_t n)
+    { return x * static_cast<float>(n); }
+
+    double mix_ifjeh(std::int32_t a, double b, std::int64_t c, float d, std::int16_t e)
+    { return a + b + static_cast<double>(c) + d + e; }
+
+    char const* pick_sj(char const* s, std::int64_t i)
+    { return s + i; }
+
+    char const* status_of(std::int64_t code)
+    {
+        static char const* const statuses[] = { "NEW", "FILLED", "CANCELLED" };
+        return statuses[code % 3];
+    }
+
+    char const* echo_s(char const* s)
+    {
+        static char buffer[16];
+        std::strncpy(buffer, s, sizeof(buffer) - 1);
+        return buffer;
+    }
+
+    /// @remark Leaves the last item unset.
+    void statuses_of(char const** out)
+    {
+        for (std::int64_t i = 0; i < 3; ++i)
+            out[i] = status_of(i);
+    }
+
+    int touched = 0;
+    void touch_i(std::int32_t x)
+    { touched = x; }
+
+    unsigned char not_b(unsigned char b)
+    { return !b; }
+
+    double sum_ffffff(double a, double b, double c, double d, double e, double f)
+    { return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f; }
+
+    std::int64_t weigh_ise(std::int32_t i, char const* s, float e)
+    { return i * 100 + static_cast<std::int64_t>(std::strlen(s)) * 10 + static_cast<std::int64_t>(e); }
+
+    void const* seen = nullptr;
+    std::int64_t sum_J(std::int64_t const* p, std::int64_t n)
+    {
+        seen = p;
+        std::int64_t sum = 0;
+        for (std::int64_t i = 0; i < n; ++i)
+            sum += p[i];
+        return sum;
+    }
+
+    double dot_FF(double const* a, double const* b, std::int64_t n)
+    {
+        double dot = 0.;
+        for (std::int64_t i = 0; i < n; ++i)
+            dot += a[i] * b[i];
+        return dot;
+    }
+
+    double sum_nF(std::int64_t n, double const* p)
+    {
+        double sum = 0.;
+        for (std::int64_t i = 0; i < n; ++i)
+            sum += p[i];
+        return sum;
+    }
+
+    double scaled_sum(double const* p, std::int64_t n, double k)
+    {
+        double sum = 0.;
+        for (std::int64_t i = 0; i < n; ++i)
+            sum += p[i];
+        return sum * k;
+    }
+
+    void twice(double const* in, double* out, std::int64_t n)
+    {
+        for (std::int64_t i = 0; i < n; ++i)
+            out[i] = 2 * in[i];
+    }
+
+    std::int32_t iota_I(std::int32_t* out, std::int32_t from)
+    {
+        for (std::int32_t i = 0; i < 4; ++i)
+            out[i] = from + i;
+        return 4;
+    }
+
+    void split(std::int64_t const* in, std::int64_t n, std::int64_t* lo, std::int64_t* hi)
+    {
+        for (std::int64_t i = 0; i < n; ++i) {
+            lo[i] = in[i] % 10;
+            hi[i] = in[i] / 10;
+        }
+    }
+
+    /// @brief Sum of the variadic arguments, of the types listed in @c types
+    ///     (the length of strings is added, and @c 'd' stands for a pointer to a double).
+    double sum_va(char const* types, ...)
+    {
+        std::va_list args;
+        va_start(args, types);
+        double sum = 0.;
+        for (auto t = types; '\0' != *t; ++t) {
+            switch (*t)
+            {
+            case 'i': sum += va_arg(args, int); break;
+            case 'j': sum += static_cast<double>(va_arg(args, std::int64_t)); break;
+            case 'f': sum += va_arg(args, double); break;
+            case 's': sum += static_cast<double>(std::strlen(va_arg(args, char const*))); break;
+            case 'd': sum += *va_arg(args, double const*); break;
+            default: break;
+            }
+        }
+        va_end(args);
+        return sum;
+    }
+
+    struct Book
+    {
+        std::int64_t id;
+        double total;
+    };
+
+    int live_books = 0;
+
+    Book* book_new(std::int64_t id)
+    {
+        ++live_books;
+        return new Book{ id, 0. };
+    }
+
+    void book_free(void* book)
+    {
+        --live_books;
+        delete static_cast<Book*>(book);
+    }
+
+    double book_add(Book* book, double amount)
+    { return book->total += amount; }
+
+}//namespace /*anonymous*/
+
+q_ffi_EXTERN q_ffi_EXPORT_API double q_ffi_test_scale(std::int64_t n, double const* values)
+{ return static_cast<double>(n) * values[0]; }
+
+q_ffi_SIGNATURE(q_ffi_test_scale)
+
+namespace q_ffi
+{
+    using namespace q;
+
+    TEST(SignatureTests, parse)
+    {
+        Signature sig{ "f", "fj s" };
+        EXPECT_EQ(sig.result().type_id, kFloat);
+        EXPECT_EQ(sig.result().native, NativeClass::kDouble);
+        ASSERT_EQ(sig.parameters().size(), 3u);
+        EXPECT_EQ(sig.parameters()[0].native, NativeClass::kDouble);
+        EXPECT_EQ(sig.parameters()[1].type_id, kLong);
+        EXPECT_EQ(sig.parameters()[1].native, NativeClass::kInteger);
+        EXPECT_EQ(sig.parameters()[2].type_id, kSymbol);
+        EXPECT_EQ(sig.parameters()[2].size, sizeof(char const*));
+        EXPECT_EQ(sig.to_str(), "f(fjs)");
+    }
+
+    TEST(SignatureTests, parseVoid)
+    {
+        Signature sig{ "", "" };
+        EXPECT_EQ(sig.result().native, NativeClass::kVoid);
+        EXPECT_TRUE(sig.parameters().empty());
+        EXPECT_EQ(sig.to_str(), " ()");
+        EXPECT_EQ(Signature(" ", "e").to_str(), " (e)");
+    }
+
+    TEST(SignatureTests, parseErrors)
+    {
+        EXPECT_THROW(Signature("ff", "f"), K_error);
+        EXPECT_THROW(Signature("?", "f"), K_error);
+        EXPECT_THROW(Signature("f", "g"), K_error);
+    }
+
+    TEST(SignatureTests, variadic)
+    {
+        Signature sig{ "i", "Cjs..." };
+        EXPECT_TRUE(sig.is_variadic());
+        EXPECT_TRUE(sig.is_open());
+        EXPECT_EQ(sig.fixed(), 3u);
+        EXPECT_EQ(sig.rank(), 4u) << "variadic arguments as one list";
+        EXPECT_EQ(sig.to_str(), "i(Cjs...)");
+
+        auto const shape = sig.with_tail("jfS");
+        EXPECT_TRUE(shape.is_variadic());
+        EXPECT_FALSE(shape.is_open());
+        EXPECT_EQ(shape.fixed(), 3u);
+        EXPECT_EQ(shape.rank(), 6u);
+        EXPECT_EQ(shape.to_str(), "i(Cjs.jfS)");
+        EXPECT_EQ(shape.native_str(), "i(Cjs...)");
+        EXPECT_EQ(Signature("i", "Cjs.").parameters().size(), 3u);
+        EXPECT_FALSE(Signature("i", "s").is_variadic());
+
+        EXPECT_THROW(Signature("i", "..."), K_error);
+        EXPECT_THROW(Signature("i", "s...j"), K_error);
+        EXPECT_THROW(Signature("i", "s.j..."), K_error);
+        EXPECT_THROW(Signature("i", "s.e"), K_error) << "promoted to f";
+        EXPECT_THROW(Signature("i", "s.J#"), K_error);
+        EXPECT_THROW(shape.with_tail("j"), K_error);
+    }
+
+    TEST(SignatureTests, pointers)
+    {
+        Signature sig{ "f", "FF#" };
+        EXPECT_EQ(sig.rank(), 2u);
+        ASSERT_EQ(sig.parameters().size(), 3u);
+        EXPECT_EQ(sig.parameters()[0].kind, ParamKind::kPointer);
+        EXPECT_EQ(sig.parameters()[0].type_id, kFloat);
+        EXPECT_EQ(sig.parameters()[0].native, NativeClass::kInteger);
+        EXPECT_EQ(sig.parameters()[2].kind, ParamKind::kCount);
+        EXPECT_EQ(sig.parameters()[2].source, 1u);
+        EXPECT_FALSE(sig.parameters()[2].is_explicit());
+        EXPECT_EQ(sig.to_str(), "f(FF#)");
+
+        Signature leading{ "f", "#FjFj" };
+        EXPECT_EQ(leading.rank(), 4u);
+        EXPECT_EQ(leading.parameters()[0].source, 1u);
+
+        EXPECT_THROW(Signature("f", "#f"), K_error);
+        EXPECT_THROW(Signature("f", "f#"), K_error);
+        EXPECT_THROW(Signature("F", "f"), K_error);
+        EXPECT_THROW(Signature("f", "G"), K_error);
+    }
+
+    TEST(SignatureTests, native)
+    {
+        using namespace std::string_view_literals;
+        static_assert(signature_v<double(std::int64_t, double const*)> == "f(jF)"sv);
+        static_assert(signature_v<void(*)(char const*, char const**, bool) noexcept> == " (sSb)"sv);
+        static_assert(signature_v<std::int32_t(void*, double (*)(double), unsigned char)> == "i(*&x)"sv);
+        static_assert(signature_v<int(char const*, ...)> == "i(s...)"sv);
+
+        EXPECT_EQ(Signature("f", "jF").native_str(), signature_v<decltype(q_ffi_test_scale)>);
+        EXPECT_EQ(Signature("d", "pD>Z#").native_str(), "i(jIFj)");
+        EXPECT_EQ(Signature(" ", "{a:j;b:f}#&").native_str(), " (*j&)");
+
+        K_ptr host{ TypeTraits<kSymbol>::atom(":") }, fn{ TypeTraits<kSymbol>::atom("q_ffi_test_scale") },
+            res{ TypeTraits<kChar>::atom('f') }, params{ TypeTraits<kChar>::list("jF") };
+        K_ptr scale{ ::load(host.get(), fn.get(), res.get(), params.get(), Nil) };
+        ASSERT_EQ(type(scale.get()), kForeign);
+        params.reset(TypeTraits<kChar>::list("nF"));
+        scale.reset(::load(host.get(), fn.get(), res.get(), params.get(), Nil));
+        EXPECT_EQ(type(scale.get()), kForeign) << "same native type";
+        params.reset(TypeTraits<kChar>::list("iF"));
+        EXPECT_EQ(::load(host.get(), fn.get(), res.get(), params.get(), Nil), Nil) << "mismatch";
+        params.reset(TypeTraits<kChar>::list("jf"));
+        EXPECT_EQ(::load(host.get(), fn.get(), res.get(), params.get(), Nil), Nil) << "mismatch";
+    }
+
+    TEST(BindingTests, scalars)
+    {
+        Binding add{ fptr(&add_ff), Signature("f", "ff") };
+        EXPECT_EQ(add.rank(), 2u);
+        K_ptr x{ TypeTraits<kFloat>::atom(1.25) }, y{ TypeTraits<kFloat>::atom(-3.5) };
+        ::K const args[] = { x.get(), y.get() };
+        K_ptr r{ add(args) };
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), -2.25);
+
+        Binding neg{ fptr(&neg_j), Signature("j", "j") };
+        K_ptr j{ TypeTraits<kLong>::atom(1LL << 40) };
+        ::K const argj[] = { j.get() };
+        r.reset(neg(argj));
+        ASSERT_EQ(type(r.get()), -kLong);
+        EXPECT_EQ(TypeTraits<kLong>::value(r.get()), -(1LL << 40));
+
+        Binding mul{ fptr(&mul_ei), Signature("e", "ei") };
+        K_ptr e{ TypeTraits<kReal>::atom(1.5f) }, i{ TypeTraits<kInt>::atom(-3) };
+        ::K const argei[] = { e.get(), i.get() };
+        r.reset(mul(argei));
+        ASSERT_EQ(type(r.get()), -kReal);
+        EXPECT_FLOAT_EQ(TypeTraits<kReal>::value(r.get()), -4.5f);
+
+        Binding inv{ fptr(&not_b), Signature("b", "b") };
+        K_ptr b{ TypeTraits<kBoolean>::atom(false) };
+        ::K const argb[] = { b.get() };
+        r.reset(inv(argb));
+        ASSERT_EQ(type(r.get()), -kBoolean);
+        EXPECT_EQ(TypeTraits<kBoolean>::value(r.get()), 1);
+    }
+
+    TEST(BindingTests, mixedClasses)
+    {
+        Binding mix{ fptr(&mix_ifjeh), Signature("f", "ifjeh") };
+        K_ptr a{ TypeTraits<kInt>::atom(1) }, b{ TypeTraits<kFloat>::atom(.5) },
+            c{ TypeTraits<kLong>::atom(100) }, d{ TypeTraits<kReal>::atom(.25f) },
+            e{ TypeTraits<kShort>::atom(-10) };
+        ::K const args[] = { a.get(), b.get(), c.get(), d.get(), e.get() };
+        K_ptr r{ mix(args) };
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 91.75);
+    }
+
+    TEST(BindingTests, strings)
+    {
+        Binding pick{ fptr(&pick_sj), Signature("s", "sj") };
+        K_ptr s{ TypeTraits<kSymbol>::atom("abcdef") }, i{ TypeTraits<kLong>::atom(2) };
+        ::K const args[] = { s.get(), i.get() };
+        K_ptr r{ pick(args) };
+        ASSERT_EQ(type(r.get()), -kSymbol);
+        EXPECT_STREQ(TypeTraits<kSymbol>::value(r.get()), "cdef");
+
+        K_ptr str{ TypeTraits<kChar>::list("xyz") };
+        ::K const args2[] = { str.get(), i.get() };
+        r.reset(pick(args2));
+        ASSERT_EQ(type(r.get()), -kSymbol);
+        EXPECT_STREQ(TypeTraits<kSymbol>::value(r.get()), "z");
+    }
+
+    TEST(BindingTests, voidResult)
+    {
+        Binding touch{ fptr(&touch_i), Signature(" ", "i") };
+        K_ptr x{ TypeTraits<kInt>::atom(42) };
+        ::K const args[] = { x.get() };
+        touched = 0;
+        EXPECT_EQ(touch(args), Nil);
+        EXPECT_EQ(touched, 42);
+    }
+
+    TEST(BindingTests, typeErrors)
+    {
+        Binding add{ fptr(&add_ff), Signature("f", "ff") };
+        K_ptr x{ TypeTraits<kFloat>::atom(1.) }, y{ TypeTraits<kLong>::atom(1) };
+        ::K const args[] = { x.get(), y.get() };
+        EXPECT_THROW(add(args), K_error);
+        EXPECT_THROW(Binding(nullptr, Signature("f", "ff")), K_error);
+    }
+
+    TEST(BindingTests, apply)
+    {
+        Binding add{ fptr(&add_ff), Signature("f", "ff") };
+        K_ptr pair{ TypeTraits<kFloat>::list({ 2., 3. }) };
+        K_ptr r{ add.apply(pair.get()) };
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 5.);
+
+        Binding pick{ fptr(&pick_sj), Signature("s", "sj") };
+        K_ptr args{ ::knk(2, TypeTraits<kSymbol>::atom("abc"), TypeTraits<kLong>::atom(1)) };
+        r.reset(pick.apply(args.get()));
+        ASSERT_EQ(type(r.get()), -kSymbol);
+        EXPECT_STREQ(TypeTraits<kSymbol>::value(r.get()), "bc");
+
+        K_ptr bad{ TypeTraits<kFloat>::list({ 1., 2., 3. }) };
+        EXPECT_THROW(add.apply(bad.get()), K_error);
+    }
+
+    TEST(BindingTests, foreignObject)
+    {
+        K_ptr b{ Binding::to_q(std::make_unique<Binding>(fptr(&add_ff), Signature("f", "ff"))) };
+        ASSERT_EQ(type(b.get()), kForeign);
+        EXPECT_EQ(Binding::from_q(b.get()).rank(), 2u);
+
+        K_ptr r{ ::rank(b.get()) };
+        ASSERT_EQ(type(r.get()), -kLong);
+        EXPECT_EQ(TypeTraits<kLong>::value(r.get()), 2);
+
+        K_ptr x{ TypeTraits<kFloat>::atom(.5) };
+        r.reset(::call2(b.get(), x.get(), x.get()));
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 1.);
+
+        EXPECT_EQ(::call1(b.get(), x.get()), Nil) << "rank mismatch should be an error";
+        EXPECT_THROW(Binding::from_q(x.get()), K_error);
+    }
+
+    TEST(PointerTests, zeroCopy)
+    {
+        Binding sum{ fptr(&sum_J), Signature("j", "J#") };
+        EXPECT_EQ(sum.rank(), 1u);
+        EXPECT_FALSE(sum.is_specialized());
+        K_ptr vec{ TypeTraits<kLong>::list({ 1, 2, 3, 4 }) };
+        ::K const args[] = { vec.get() };
+        K_ptr r{ sum(args) };
+        ASSERT_EQ(type(r.get()), -kLong);
+        EXPECT_EQ(TypeTraits<kLong>::value(r.get()), 10);
+        EXPECT_EQ(seen, TypeTraits<kLong>::index(vec.get())) << "items must not be copied";
+
+        ::K const none[] = { Nil };
+        r.reset(sum(none));
+        EXPECT_EQ(TypeTraits<kLong>::value(r.get()), 0);
+        EXPECT_EQ(seen, nullptr);
+
+        Binding dot{ fptr(&dot_FF), Signature("f", "FF#") };
+        K_ptr a{ TypeTraits<kFloat>::list({ 1., 2., 3. }) }, b{ TypeTraits<kFloat>::list({ 4., 5., 6. }) };
+        ::K const ab[] = { a.get(), b.get() };
+        r.reset(dot(ab));
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 32.);
+
+        Binding leading{ fptr(&sum_nF), Signature("f", "#F") };
+        ::K const as[] = { a.get() };
+        r.reset(leading(as));
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 6.);
+    }
+
+    TEST(PointerTests, mismatch)
+    {
+        Binding sum{ fptr(&sum_J), Signature("j", "J#") };
+        K_ptr ints{ TypeTraits<kInt>::list({ 1, 2 }) };
+        ::K const args[] = { ints.get() };
+        try {
+            K_ptr r{ sum(args) };
+            FAIL() << "width mismatch should be rejected";
+        }
+        catch (K_error const& ex) {
+            EXPECT_STREQ(ex.what(), "'J' expects 8-byte items, got 4-byte items");
+        }
+
+        K_ptr floats{ TypeTraits<kFloat>::list({ 1., 2. }) }, atom{ TypeTraits<kLong>::atom(1) };
+        ::K const same[] = { floats.get() };
+        EXPECT_THROW(sum(same), K_error);
+        ::K const scalar[] = { atom.get() };
+        EXPECT_THROW(sum(scalar), K_error);
+
+        K_ptr longs{ TypeTraits<kLong>::list({ 1, 2 }) };
+        EXPECT_THROW(sum.apply(longs.get()), K_error) << "simple list items cannot be pointers";
+    }
+
+    TEST(PointerTests, each)
+    {
+        Binding scaled{ fptr(&scaled_sum), Signature("f", "F#f") };
+        EXPECT_EQ(scaled.rank(), 2u);
+        K_ptr vec{ TypeTraits<kFloat>::list({ 1., 2., 3. }) }, factors{ TypeTraits<kFloat>::list({ 1., 10. }) };
+        ::K const args[] = { vec.get(), factors.get() };
+        K_ptr r{ scaled(args) };
+        ASSERT_EQ(type(r.get()), kFloat) << "pointer argument broadcast in each mode";
+        ASSERT_EQ(count(r.get()), 2);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[0], 6.);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[1], 60.);
+    }
+
+    TEST(PointerTests, buffers)
+    {
+        K_ptr f{ TypeTraits<kChar>::atom('f') }, n{ TypeTraits<kLong>::atom(3) };
+        K_ptr buffer{ ::alloc(f.get(), n.get(), Nil) };
+        ASSERT_EQ(type(buffer.get()), kForeign);
+        auto const& native = Handle::from_q(buffer.get());
+        EXPECT_TRUE(native.is_buffer());
+        EXPECT_EQ(native.type(), kFloat);
+        EXPECT_EQ(native.count(), 3u);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(native.get()) % kBufferAlignment, 0u);
+        EXPECT_DOUBLE_EQ(static_cast<double const*>(native.get())[2], 0.) << "zero-filled";
+
+        K_ptr vec{ TypeTraits<kFloat>::list({ 1., 2., 3. }) };
+        K_ptr r{ ::copyIn(buffer.get(), vec.get()) };
+        ASSERT_EQ(type(r.get()), kNil);
+        Binding scaled{ fptr(&scaled_sum), Signature("f", "F#f") };
+        K_ptr k{ TypeTraits<kFloat>::atom(10.) };
+        ::K args[] = { buffer.get(), k.get() };
+        r.reset(scaled(args));
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 60.) << "passed in place of a list, with its count";
+
+        Binding doubled{ fptr(&twice), Signature(" ", "F>F#") };
+        ::K const in = buffer.get();
+        r.reset(doubled(&in));
+        ASSERT_EQ(type(r.get()), kFloat);
+        ASSERT_EQ(count(r.get()), 3) << "output sized by the buffer";
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[2], 6.);
+
+        r.reset(::copyOut(buffer.get()));
+        ASSERT_EQ(type(r.get()), kFloat);
+        ASSERT_EQ(count(r.get()), 3);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[1], 2.);
+
+        K_ptr longs{ TypeTraits<kLong>::list({ 1, 2 }) }, more{ TypeTraits<kFloat>::list({ 1., 2., 3., 4. }) };
+        EXPECT_EQ(::copyIn(buffer.get(), longs.get()), Nil) << "type";
+        EXPECT_EQ(::copyIn(buffer.get(), more.get()), Nil) << "length";
+        Binding sum{ fptr(&sum_J), Signature("j", "J#") };
+        EXPECT_THROW(sum(&in), K_error) << "buffer of another type";
+
+        K_ptr page{ TypeTraits<kLong>::atom(4096) }, i{ TypeTraits<kChar>::atom('J') };
+        K_ptr aligned{ ::alloc(i.get(), n.get(), page.get()) };
+        ASSERT_EQ(type(aligned.get()), kForeign);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(Handle::from_q(aligned.get()).get()) % 4096, 0u);
+        EXPECT_EQ(Handle::from_q(aligned.get()).type(), kLong);
+        K_ptr odd{ TypeTraits<kLong>::atom(48) };
+        EXPECT_EQ(::alloc(f.get(), n.get(), odd.get()), Nil) << "not a power of 2";
+        K_ptr s{ TypeTraits<kChar>::atom('s') };
+        EXPECT_EQ(::alloc(s.get(), n.get(), Nil), Nil) << "no symbols";
+        K_ptr huge{ TypeTraits<kLong>::atom(0x2000000000000001) };
+        EXPECT_EQ(::alloc(f.get(), huge.get(), Nil), Nil) << "size overflow";
+        EXPECT_THROW(Handle::allocate(kFloat, std::numeric_limits<std::size_t>::max() / 8, 8), K_error);
+        EXPECT_THROW(Handle::allocate(kByte, std::numeric_limits<std::size_t>::max(), 8), K_error)
+            << "beyond the count of a q list";
+
+        r.reset(::release(buffer.get()));
+        EXPECT_EQ(::copyOut(buffer.get()), Nil) << "released";
+        EXPECT_THROW(scaled(args), K_error);
+    }
+
+    TEST(OutputTests, signature)
+    {
+        Signature sig{ " ", "F>F#" };
+        EXPECT_EQ(sig.rank(), 1u);
+        ASSERT_EQ(sig.parameters().size(), 3u);
+        EXPECT_EQ(sig.parameters()[1].kind, ParamKind::kOutput);
+        EXPECT_EQ(sig.parameters()[1].source, 0u);
+        EXPECT_EQ(sig.parameters()[2].source, 0u) << "'#' does not count outputs as pointers";
+        EXPECT_EQ(sig.to_str(), " (F>F#)");
+
+        Signature constant{ "i", ">i4 i" };
+        EXPECT_EQ(constant.rank(), 1u);
+        EXPECT_EQ(constant.parameters()[0].type_id, kInt);
+        EXPECT_EQ(constant.parameters()[0].source, kNoSource);
+        EXPECT_EQ(constant.parameters()[0].length, 4u);
+        EXPECT_EQ(constant.to_str(), "i(>I4i)");
+
+        Signature byArg{ " ", "j>F@1j" };
+        EXPECT_EQ(byArg.parameters()[1].source, 2u);
+        EXPECT_EQ(byArg.to_str(), " (j>F@1j)");
+
+        EXPECT_THROW(Signature(" ", ">"), K_error);
+        EXPECT_THROW(Signature(" ", ">F"), K_error);
+        EXPECT_THROW(Signature(" ", "j>F@"), K_error);
+        EXPECT_THROW(Signature(" ", "j>F@1"), K_error);
+        EXPECT_THROW(Signature(" ", ">#"), K_error);
+    }
+
+    TEST(OutputTests, call)
+    {
+        Binding dbl{ fptr(&twice), Signature(" ", "F>F#") };
+        K_ptr in{ TypeTraits<kFloat>::list({ 1., 2., 3. }) };
+        ::K const args[] = { in.get() };
+        K_ptr r{ dbl(args) };
+        ASSERT_EQ(type(r.get()), kFloat);
+        ASSERT_EQ(count(r.get()), 3u);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[2], 6.);
+        ::K const none[] = { Nil };
+        r.reset(dbl(none));
+        ASSERT_EQ(type(r.get()), kFloat);
+        EXPECT_EQ(count(r.get()), 0u) << "sized by a null pointer";
+
+        Binding iota{ fptr(&iota_I), Signature("i", ">I4i") };
+        K_ptr from{ TypeTraits<kInt>::atom(7) };
+        ::K const start[] = { from.get() };
+        r.reset(iota(start));
+        ASSERT_EQ(type(r.get()), kMixed) << "(result; output)";
+        ASSERT_EQ(count(r.get()), 2u);
+        auto const items = TypeTraits<kMixed>::index(r.get());
+        ASSERT_EQ(type(items[0]), -kInt);
+        EXPECT_EQ(TypeTraits<kInt>::value(items[0]), 4);
+        ASSERT_EQ(type(items[1]), kInt);
+        ASSERT_EQ(count(items[1]), 4u);
+        EXPECT_EQ(TypeTraits<kInt>::index(items[1])[3], 10);
+
+        Binding halves{ fptr(&split), Signature(" ", "J#>J>J") };
+        K_ptr nums{ TypeTraits<kLong>::list({ 12, 34 }) };
+        ::K const numArgs[] = { nums.get() };
+        r.reset(halves(numArgs));
+        ASSERT_EQ(type(r.get()), kMixed);
+        ASSERT_EQ(count(r.get()), 2u);
+        EXPECT_EQ(TypeTraits<kLong>::index(TypeTraits<kMixed>::index(r.get())[0])[1], 4);
+        EXPECT_EQ(TypeTraits<kLong>::index(TypeTraits<kMixed>::index(r.get())[1])[1], 3);
+
+        K_ptr starts{ TypeTraits<kInt>::list({ 1, 2 }) };
+        ::K const each[] = { starts.get() };
+        EXPECT_THROW(iota(each), K_error) << "no each mode with output buffers";
+    }
+
+    TEST(ThunkTests, selection)
+    {
+        EXPECT_NE(select_thunk(Signature("f", "ff")), nullptr);
+        EXPECT_NE(select_thunk(Signature("j", "j")), nullptr);
+        EXPECT_NE(select_thunk(Signature(" ", "")), nullptr);
+        EXPECT_NE(select_thunk(Signature("s", "sie")), nullptr);
+        EXPECT_NE(select_thunk(Signature("e", "ffffff")), nullptr);
+        EXPECT_EQ(select_thunk(Signature("f", "fjfe")), nullptr) << "mixed types beyond thunk table";
+        EXPECT_EQ(select_thunk(Signature("f", "b")), nullptr);
+        EXPECT_EQ(select_thunk(Signature("h", "f")), nullptr);
+        EXPECT_NE(select_thunk(Signature("f", "ff")), select_thunk(Signature("f", "fj")));
+        EXPECT_NE(select_thunk(Signature("f", "fj")), select_thunk(Signature("f", "jf")));
+
+        EXPECT_TRUE(Binding(fptr(&add_ff), Signature("f", "ff")).is_specialized());
+        EXPECT_FALSE(Binding(fptr(&not_b), Signature("b", "b")).is_specialized());
+    }
+
+    TEST(ThunkTests, uniform)
+    {
+        Binding sum{ fptr(&sum_ffffff), Signature("f", "ffffff") };
+        ASSERT_TRUE(sum.is_specialized());
+        std::vector<K_ptr> holders;
+        std::vector<::K> args;
+        for (auto v : { 1., 10., 100., 1000., 10000., 100000. }) {
+            holders.emplace_back(TypeTraits<kFloat>::atom(v));
+            args.push_back(holders.back().get());
+        }
+        K_ptr r{ sum(args.data()) };
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 654321.);
+    }
+
+    TEST(ThunkTests, mixed)
+    {
+        Binding weigh{ fptr(&weigh_ise), Signature("j", "ise") };
+        ASSERT_TRUE(weigh.is_specialized());
+        K_ptr i{ TypeTraits<kInt>::atom(7) }, s{ TypeTraits<kSymbol>::atom("abcd") },
+            e{ TypeTraits<kReal>::atom(3.9f) };
+        ::K const args[] = { i.get(), s.get(), e.get() };
+        K_ptr r{ weigh(args) };
+        ASSERT_EQ(type(r.get()), -kLong);
+        EXPECT_EQ(TypeTraits<kLong>::value(r.get()), 743);
+
+        // Not an exact match for the thunk: falls back to generic marshaling
+        K_ptr str{ TypeTraits<kChar>::list("ab") };
+        ::K const args2[] = { i.get(), str.get(), e.get() };
+        r.reset(weigh(args2));
+        ASSERT_EQ(type(r.get()), -kLong);
+        EXPECT_EQ(TypeTraits<kLong>::value(r.get()), 723);
+
+        K_ptr j{ TypeTraits<kLong>::atom(7) };
+        ::K const args3[] = { j.get(), s.get(), e.get() };
+        EXPECT_THROW(weigh(args3), K_error);
+    }
+
+    TEST(EachTests, broadcast)
+    {
+        Binding add{ fptr(&add_ff), Signature("f", "ff") };
+        K_ptr vec{ TypeTraits<kFloat>::list({ 1., 2., 3. }) }, y{ TypeTraits<kFloat>::atom(.5) };
+        ::K const args[] = { vec.get(), y.get() };
+        K_ptr r{ add(args) };
+        ASSERT_EQ(type(r.get()), kFloat);
+        ASSERT_EQ(count(r.get()), 3);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[0], 1.5);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[2], 3.5);
+
+        ::K const pair[] = { vec.get(), vec.get() };
+        r.reset(add(pair));
+        ASSERT_EQ(type(r.get()), kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[1], 4.);
+
+        K_ptr empty{ TypeTraits<kFloat>::list({}) };
+        ::K const none[] = { empty.get(), y.get() };
+        r.reset(add(none));
+        ASSERT_EQ(type(r.get()), kFloat);
+        EXPECT_EQ(count(r.get()), 0);
+
+        K_ptr vec2{ TypeTraits<kFloat>::list({ 1., 2. }) };
+        ::K const bad[] = { vec.get(), vec2.get() };
+        EXPECT_THROW(add(bad), K_error);
+    }
+
+    TEST(EachTests, symbols)
+    {
+        Binding pick{ fptr(&pick_sj), Signature("s", "sj") };
+        K_ptr ss{ TypeTraits<kSymbol>::list({ "abc", "de" }) }, is{ TypeTraits<kLong>::list({ 1, 2 }) };
+        ::K const args[] = { ss.get(), is.get() };
+        K_ptr r{ pick(args) };
+        ASSERT_EQ(type(r.get()), kSymbol);
+        ASSERT_EQ(count(r.get()), 2);
+        EXPECT_STREQ(TypeTraits<kSymbol>::index(r.get())[0], "bc");
+        EXPECT_STREQ(TypeTraits<kSymbol>::index(r.get())[1], "");
+
+        K_ptr str{ TypeTraits<kChar>::list("xyz") };
+        ::K const strs[] = { str.get(), is.get() };
+        r.reset(pick(strs));
+        ASSERT_EQ(type(r.get()), kSymbol) << "a string is a scalar for a symbol parameter";
+        EXPECT_STREQ(TypeTraits<kSymbol>::index(r.get())[1], "z");
+    }
+
+    TEST(EachTests, generic)
+    {
+        Binding mix{ fptr(&mix_ifjeh), Signature("f", "ifjeh") };
+        K_ptr a{ TypeTraits<kInt>::atom(1) }, b{ TypeTraits<kFloat>::atom(.5) },
+            c{ TypeTraits<kLong>::list({ 10, 20 }) }, d{ TypeTraits<kReal>::atom(.25f) },
+            e{ TypeTraits<kShort>::list({ 100, 200 }) };
+        ::K const args[] = { a.get(), b.get(), c.get(), d.get(), e.get() };
+        K_ptr r{ mix(args) };
+        ASSERT_EQ(type(r.get()), kFloat);
+        ASSERT_EQ(count(r.get()), 2);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[0], 111.75);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[1], 221.75);
+
+        Binding inv{ fptr(&not_b), Signature("b", "b") };
+        K_ptr bools{ TypeTraits<kBoolean>::list({ true, false }) };
+        ::K const argb[] = { bools.get() };
+        r.reset(inv(argb));
+        ASSERT_EQ(type(r.get()), kBoolean);
+        EXPECT_FALSE(TypeTraits<kBoolean>::index(r.get())[0]);
+        EXPECT_TRUE(TypeTraits<kBoolean>::index(r.get())[1]);
+
+        Binding touch{ fptr(&touch_i), Signature(" ", "i") };
+        K_ptr is{ TypeTraits<kInt>::list({ 1, 2, 3 }) };
+        ::K const argi[] = { is.get() };
+        touched = 0;
+        EXPECT_EQ(touch(argi), Nil);
+        EXPECT_EQ(touched, 3);
+    }
+
+    TEST(EachTests, parallel)
+    {
+        auto& pool = WorkerPool::instance();
+        auto const saved = pool.size();
+        pool.resize(3);
+
+        BindingOptions options;
+        options.parallel = true;
+        options.grain = 10;
+        Binding add{ fptr(&add_ff), Signature("f", "ff"), nullptr, options };
+        std::vector<double> values(1000);
+        std::iota(values.begin(), values.end(), 0.);
+        K_ptr vec{ TypeTraits<kFloat>::list(values.begin(), values.end()) }, y{ TypeTraits<kFloat>::atom(.5) };
+        ::K const args[] = { vec.get(), y.get() };
+        K_ptr r{ add(args) };
+        ASSERT_EQ(type(r.get()), kFloat);
+        ASSERT_EQ(count(r.get()), 1000);
+        for (std::size_t i = 0; i < values.size(); ++i)
+            ASSERT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[i], values[i] + .5);
+
+        Binding mix{ fptr(&mix_ifjeh), Signature("f", "ifjeh"), nullptr, options };
+        K_ptr a{ TypeTraits<kInt>::atom(1) }, b{ TypeTraits<kFloat>::atom(.5) },
+            c{ TypeTraits<kLong>::atom(10) }, d{ TypeTraits<kReal>::atom(.25f) };
+        std::vector<::H> es(100);
+        std::iota(es.begin(), es.end(), static_cast<::H>(0));
+        K_ptr e{ TypeTraits<kShort>::list(es.begin(), es.end()) };
+        ::K const mixed[] = { a.get(), b.get(), c.get(), d.get(), e.get() };
+        r.reset(mix(mixed));
+        ASSERT_EQ(type(r.get()), kFloat);
+        for (std::size_t i = 0; i < es.size(); ++i)
+            ASSERT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[i], 11.75 + es[i]);
+
+        K_ptr f{ TypeTraits<kLong>::list({ 1, 2 }) };
+        ::K const bad[] = { a.get(), b.get(), f.get(), d.get(), e.get() };
+        EXPECT_THROW(mix(bad), K_error);
+
+        pool.resize(saved);
+    }
+
+    TEST(BindingTests, sharedPrototype)
+    {
+        BindingOptions options;
+        options.name = "add_ff";
+        auto add = std::make_unique<Binding>(fptr(&add_ff), Signature("f", "ff"), nullptr, options);
+        options.name = "add_again";
+        Binding again{ fptr(&add_ff), Signature("f", "ff"), nullptr, options };
+        Binding mul{ fptr(&mul_ei), Signature("e", "ei") };
+        EXPECT_EQ(&add->prototype(), &again.prototype());
+        EXPECT_NE(&add->prototype(), &mul.prototype());
+        EXPECT_STREQ(add->prototype().invoker_kind(), "thunk");
+
+        auto const find = [](char const* sig) -> ::K {
+            K_ptr table{ Prototype::table() };
+            auto const columns = kK(table->k)[1];
+            for (::J i = 0; i < count(kK(columns)[0]); ++i) {
+                if (q2Str(kK(kK(columns)[0])[i]) == sig)
+                    return ::r1(kK(kK(columns)[3])[i]);
+            }
+            return nullptr;
+        };
+        K_ptr users{ find("f(ff)") };
+        ASSERT_NE(users.get(), nullptr);
+        ASSERT_EQ(count(users.get()), 2);
+        EXPECT_STREQ(kS(users.get())[0], "add_ff");
+        EXPECT_STREQ(kS(users.get())[1], "add_again");
+
+        add.reset();
+        users.reset(find("f(ff)"));
+        ASSERT_EQ(count(users.get()), 1) << "released by the binding";
+        EXPECT_STREQ(kS(users.get())[0], "add_again");
+
+        K_ptr x{ TypeTraits<kFloat>::atom(1.) }, y{ TypeTraits<kFloat>::atom(2.) };
+        ::K const args[] = { x.get(), y.get() };
+        K_ptr r{ again(args) };
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 3.);
+    }
+
+    TEST(BindingTests, releasedPrototype)
+    {
+        auto const before = Prototype::registered();
+        auto once = std::make_unique<Binding>(fptr(&add_ff), Signature("x", "xhxh"));
+        auto twice = std::make_unique<Binding>(fptr(&add_ff), Signature("x", "xhxh"));
+        EXPECT_EQ(Prototype::registered(), before + 1);
+        once.reset();
+        EXPECT_EQ(Prototype::registered(), before + 1) << "still bound";
+        twice.reset();
+        EXPECT_EQ(Prototype::registered(), before) << "dropped without a sweep";
+    }
+
+    TEST(BindingTests, symbolCache)
+    {
+        Binding status{ fptr(&status_of), Signature("s", "j") };
+        EXPECT_TRUE(status.is_specialized());
+        for (::J i = 0; i < 30; ++i) {
+            K_ptr code{ TypeTraits<kLong>::atom(i) };
+            ::K args[] = { code.get() };
+            K_ptr r{ status(args) };
+            ASSERT_EQ(type(r.get()), -kSymbol);
+            EXPECT_EQ(TypeTraits<kSymbol>::value(r.get()), ::ss(const_cast<::S>(status_of(i))));
+        }
+        EXPECT_EQ(status.symbols().misses(), 3u);
+        EXPECT_EQ(status.symbols().hits(), 27u);
+
+        std::vector<::J> codes(100);
+        std::iota(codes.begin(), codes.end(), 0);
+        K_ptr list{ TypeTraits<kLong>::list(codes.begin(), codes.end()) };
+        ::K args[] = { list.get() };
+        K_ptr r{ status(args) };
+        ASSERT_EQ(type(r.get()), kSymbol);
+        EXPECT_EQ(TypeTraits<kSymbol>::index(r.get())[99], ::ss(const_cast<::S>("NEW")));
+        EXPECT_EQ(status.symbols().misses(), 3u);
+
+        Binding echo{ fptr(&echo_s), Signature("s", "s") };
+        K_ptr a{ TypeTraits<kSymbol>::atom("abc") }, b{ TypeTraits<kSymbol>::atom("xyz") };
+        args[0] = a.get();
+        r.reset(echo(args));
+        args[0] = b.get();
+        r.reset(echo(args));
+        EXPECT_STREQ(TypeTraits<kSymbol>::value(r.get()), "xyz") << "same address, new contents";
+        EXPECT_EQ(TypeTraits<kSymbol>::value(r.get()), TypeTraits<kSymbol>::value(b.get()));
+
+        Binding fill{ fptr(&statuses_of), Signature(" ", ">S4") };
+        r.reset(fill(nullptr));
+        ASSERT_EQ(type(r.get()), kSymbol);
+        ASSERT_EQ(count(r.get()), 4);
+        EXPECT_EQ(TypeTraits<kSymbol>::index(r.get())[1], ::ss(const_cast<::S>("FILLED")));
+        EXPECT_EQ(TypeTraits<kSymbol>::index(r.get())[3], ::ss(const_cast<::S>("")));
+    }
+
+    TEST(EachTests, rows)
+    {
+        Binding mix{ fptr(&mix_ifjeh), Signature("f", "ifjeh") };
+        K_ptr table{ ::xT(::xD(TypeTraits<kSymbol>::list({ "a", "b", "c", "d", "e" }),
+            ::knk(5, TypeTraits<kInt>::list({ 1, 2, 3 }), TypeTraits<kFloat>::list({ .5, .25, 0. }),
+                TypeTraits<kLong>::list({ 10, 20, 30 }), TypeTraits<kReal>::list({ .25f, .5f, 1.f }),
+                TypeTraits<kShort>::list({ 0, 1, 2 })))) };
+        K_ptr r{ mix.apply_rows(table.get()) };
+        ASSERT_EQ(type(r.get()), kFloat);
+        ASSERT_EQ(count(r.get()), 3);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[0], 11.75);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[1], 23.75);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(r.get())[2], 36.);
+
+        K_ptr args{ TypeTraits<kLong>::list({ 1, 2 }) };
+        EXPECT_THROW(mix.apply_rows(args.get()), K_error);
+        Binding add{ fptr(&add_ff), Signature("f", "ff") };
+        EXPECT_THROW(add.apply_rows(table.get()), K_error);
+        table.reset(::xT(::xD(TypeTraits<kSymbol>::list({ "x", "y" }),
+            ::knk(2, TypeTraits<kFloat>::list({ 1., 2. }), TypeTraits<kLong>::list({ 1, 2 })))));
+        EXPECT_THROW(add.apply_rows(table.get()), K_error) << "columns must be of the exact type";
+    }
+
+#ifndef _WIN32
+    TEST(BindingTests, loadLibrary)
+    {
+        K_ptr lib{ TypeTraits<kSymbol>::atom(":libm.so.6") }, fn{ TypeTraits<kSymbol>::atom("pow") },
+            res{ TypeTraits<kChar>::atom('f') }, params{ TypeTraits<kChar>::list("ff") };
+        K_ptr b{ ::load(lib.get(), fn.get(), res.get(), params.get(), Nil) };
+        ASSERT_EQ(type(b.get()), kForeign);
+
+        K_ptr x{ TypeTraits<kFloat>::atom(2.) }, y{ TypeTraits<kFloat>::atom(10.) };
+        K_ptr r{ ::call2(b.get(), x.get(), y.get()) };
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 1024.);
+
+        K_ptr options{ ::xD(TypeTraits<kSymbol>::list({ "parallel", "grain" }),
+            ::knk(2, TypeTraits<kBoolean>::atom(true), TypeTraits<kLong>::atom(100))) };
+        b.reset(::load(lib.get(), fn.get(), res.get(), params.get(), options.get()));
+        ASSERT_EQ(type(b.get()), kForeign);
+        EXPECT_TRUE(Binding::from_q(b.get()).options().parallel);
+        EXPECT_EQ(Binding::from_q(b.get()).options().grain, 100u);
+
+        options.reset(::xD(TypeTraits<kSymbol>::list({ "bogus" }), TypeTraits<kLong>::list({ 1 })));
+        EXPECT_EQ(::load(lib.get(), fn.get(), res.get(), params.get(), options.get()), Nil);
+
+        K_ptr libc{ TypeTraits<kSymbol>::atom(":libc.so.6") }, malloc{ TypeTraits<kSymbol>::atom("malloc") },
+            handle{ TypeTraits<kChar>::atom('*') }, size{ TypeTraits<kChar>::list("j") };
+        options.reset(::xD(TypeTraits<kSymbol>::list({ "parallel", "destructor" }),
+            ::knk(2, TypeTraits<kBoolean>::atom(true), TypeTraits<kSymbol>::atom("free"))));
+        b.reset(::load(libc.get(), malloc.get(), handle.get(), size.get(), options.get()));
+        ASSERT_EQ(type(b.get()), kForeign) << "destructor among other options";
+        EXPECT_NE(Binding::from_q(b.get()).options().destructor, nullptr);
+        options.reset(::xD(TypeTraits<kSymbol>::list({ "destructor", "grain" }),
+            ::knk(2, TypeTraits<kSymbol>::list({ "free" }), TypeTraits<kLong>::atom(10))));
+        EXPECT_EQ(::load(libc.get(), malloc.get(), handle.get(), size.get(), options.get()), Nil)
+            << "one symbol per option";
+
+        options.reset(::xD(TypeTraits<kSymbol>::list({ "flags" }), TypeTraits<kSymbol>::list({ "now" })));
+        b.reset(::load(lib.get(), fn.get(), res.get(), params.get(), options.get()));
+        EXPECT_EQ(type(b.get()), kForeign) << "a single flag";
+        options.reset(::xD(TypeTraits<kSymbol>::list({ "flags", "destructor" }),
+            TypeTraits<kSymbol>::list({ "now", "free" })));
+        b.reset(::load(libc.get(), malloc.get(), handle.get(), size.get(), options.get()));
+        EXPECT_EQ(type(b.get()), kForeign) << "a flag among other symbols";
+        options.reset(::xD(TypeTraits<kSymbol>::list({ "flags" }),
+            ::knk(1, TypeTraits<kSymbol>::list({ "lazy", "global" }))));
+        b.reset(::load(lib.get(), fn.get(), res.get(), params.get(), options.get()));
+        EXPECT_EQ(type(b.get()), kForeign) << "a list of flags";
+        options.reset(::xD(TypeTraits<kSymbol>::list({ "flags" }), TypeTraits<kSymbol>::list({ "bogus" })));
+        EXPECT_EQ(::load(lib.get(), fn.get(), res.get(), params.get(), options.get()), Nil);
+
+        K_ptr missing{ TypeTraits<kSymbol>::atom("no_such_function") };
+        EXPECT_EQ(::load(lib.get(), missing.get(), res.get(), params.get(), Nil), Nil);
+    }
+
+    TEST(BindingTests, manifest)
+    {
+        K_ptr lib{ TypeTraits<kSymbol>::atom(":libm.so.6") };
+        K_ptr manifest{ ::knk(5, TypeTraits<kChar>::list("pow f ff"), TypeTraits<kChar>::list(""),
+            TypeTraits<kChar>::list("/ rounding"), TypeTraits<kChar>::list("  floor\tf  f "),
+            TypeTraits<kChar>::list("fegetround i")) };
+        K_ptr dict{ ::bindAll(lib.get(), manifest.get(), Nil) };
+        ASSERT_EQ(type(dict.get()), kDict);
+        auto const names = kK(dict.get())[0];
+        auto const funcs = kK(dict.get())[1];
+        ASSERT_EQ(type(names), kSymbol);
+        ASSERT_EQ(count(names), 3);
+        EXPECT_STREQ(kS(names)[1], "floor");
+        EXPECT_EQ(Binding::from_q(kK(funcs)[0]).signature().to_str(), "f(ff)");
+        EXPECT_EQ(Binding::from_q(kK(funcs)[2]).rank(), 0u);
+        K_ptr again{ ::bindAll(lib.get(), manifest.get(), Nil) };
+        ASSERT_EQ(type(again.get()), kDict);
+        EXPECT_EQ(&Binding::from_q(kK(funcs)[1]).prototype(),
+            &Binding::from_q(kK(kK(again.get())[1])[1]).prototype()) << "signatures shared";
+
+        K_ptr x{ TypeTraits<kFloat>::atom(2.5) };
+        K_ptr r{ ::call1(kK(funcs)[1], x.get()) };
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 2.);
+
+        manifest.reset(TypeTraits<kChar>::list("fegetround i _"));
+        K_ptr none{ ::bindAll(lib.get(), manifest.get(), Nil) };
+        ASSERT_EQ(type(none.get()), kDict) << "'_' for no parameters";
+        EXPECT_EQ(Binding::from_q(kK(kK(none.get())[1])[0]).rank(), 0u);
+
+        manifest.reset(TypeTraits<kChar>::list("pow f ff\nno_such_function _ j\n"));
+        EXPECT_EQ(::bindAll(lib.get(), manifest.get(), Nil), Nil);
+
+        K_ptr options{ ::xD(TypeTraits<kSymbol>::list({ "lazy" }), TypeTraits<kBoolean>::list({ true })) };
+        dict.reset(::bindAll(lib.get(), manifest.get(), options.get()));
+        ASSERT_EQ(type(dict.get()), kDict);
+        auto const& lazy = Binding::from_q(kK(kK(dict.get())[1])[1]);
+        EXPECT_TRUE(lazy.is_lazy());
+        K_ptr n{ TypeTraits<kLong>::atom(1) };
+        EXPECT_EQ(::call1(kK(kK(dict.get())[1])[1], n.get()), Nil) << "reported when called";
+        auto const& pow = Binding::from_q(kK(kK(dict.get())[1])[0]);
+        K_ptr y{ TypeTraits<kFloat>::atom(3.) };
+        r.reset(::call2(kK(kK(dict.get())[1])[0], x.get(), y.get()));
+        EXPECT_FALSE(pow.is_lazy());
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 15.625);
+
+        manifest.reset(TypeTraits<kChar>::list("pow f ff j"));
+        EXPECT_EQ(::bindAll(lib.get(), manifest.get(), Nil), Nil);
+    }
+#endif
+
+    TEST(BindingTests, handles)
+    {
+        BindingOptions options;
+        options.destructor = fptr(&book_free);
+        Binding make{ fptr(&book_new), Signature("*", "j"), nullptr, options };
+        Binding add{ fptr(&book_add), Signature("f", "*f") };
+        EXPECT_EQ(add.signature().native_str(), "f(*f)");
+        ASSERT_EQ(live_books, 0);
+
+        K_ptr id{ TypeTraits<kLong>::atom(7) };
+        ::K const seven = id.get();
+        K_ptr book{ make(&seven) };
+        ASSERT_EQ(type(book.get()), kForeign);
+        EXPECT_EQ(static_cast<Book*>(Handle::from_q(book.get()).get())->id, 7);
+        EXPECT_EQ(live_books, 1);
+
+        K_ptr amount{ TypeTraits<kFloat>::atom(1.5) };
+        ::K args[] = { book.get(), amount.get() };
+        K_ptr r{ add(args) };
+        r.reset(add(args));
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 3.) << "native state kept across calls";
+        args[0] = id.get();
+        EXPECT_THROW(add(args), K_error);
+
+        K_ptr other{ make(&seven) };
+        EXPECT_EQ(live_books, 2);
+        other.reset();
+        EXPECT_EQ(live_books, 1) << "destroyed when q releases it";
+
+        K_ptr none{ ::release(book.get()) };
+        EXPECT_EQ(live_books, 0);
+        EXPECT_EQ(Handle::from_q(book.get()).get(), nullptr);
+        args[0] = book.get();
+        EXPECT_THROW(add(args), K_error) << "released";
+        book.reset();
+        EXPECT_EQ(live_books, 0) << "destroyed once";
+
+        Binding borrow{ fptr(&book_new), Signature("*", "j") };
+        book.reset(borrow(&seven));
+        auto const raw = static_cast<Book*>(Handle::from_q(book.get()).get());
+        book.reset();
+        EXPECT_EQ(live_books, 1) << "no destructor";
+        book_free(raw);
+
+        K_ptr ids{ TypeTraits<kLong>::list({ 1, 2 }) };
+        ::K const many = ids.get();
+        EXPECT_THROW(make(&many), K_error) << "no list of handles";
+        EXPECT_EQ(live_books, 0);
+    }
+
+#ifdef q_ffi_SYSV_CALL
+    TEST(BindingTests, variadic)
+    {
+        Binding sum{ fptr(&sum_va), Signature("f", "s...") };
+        EXPECT_EQ(sum.rank(), 2u);
+        EXPECT_FALSE(sum.is_specialized());
+        auto const shapes = [] {
+            K_ptr table{ Prototype::table() };
+            return count(kK(kK(table->k)[1])[0]);
+        };
+        auto const before = shapes();
+
+        K_ptr types{ TypeTraits<kChar>::list("iijfs") };
+        K_ptr rest{ ::knk(5, TypeTraits<kShort>::atom(-3), TypeTraits<kInt>::atom(4),
+            TypeTraits<kLong>::atom(5), TypeTraits<kReal>::atom(2.5f), TypeTraits<kChar>::list("abc")) };
+        ::K args[] = { types.get(), rest.get() };
+        K_ptr r{ sum(args) };
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 11.5);
+        EXPECT_EQ(shapes(), before + 1);
+
+        TypeTraits<kShort>::value(kK(rest.get())[0]) = 10;
+        r.reset(sum(args));
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 24.5);
+        EXPECT_EQ(shapes(), before + 1) << "shape compiled once";
+
+        // spill both integer and vector registers onto the stack
+        K_ptr many{ TypeTraits<kChar>::list("ffffffffffjjjjjjd") };
+        K_ptr all{ ::ktn(kMixed, 17) };
+        for (int i = 0; i < 10; ++i)
+            kK(all.get())[i] = TypeTraits<kFloat>::atom(i + 1);
+        for (int i = 0; i < 6; ++i)
+            kK(all.get())[10 + i] = TypeTraits<kLong>::atom(100 * (i + 1));
+        kK(all.get())[16] = TypeTraits<kFloat>::list({ .25 });
+        K_ptr list{ ::knk(2, ::r1(many.get()), ::r1(all.get())) };
+        r.reset(sum.apply(list.get()));
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 55. + 2100. + .25);
+        EXPECT_EQ(shapes(), before + 2);
+
+        K_ptr blank{ TypeTraits<kChar>::list("") }, none{ ::ktn(kMixed, 0) };
+        ::K empty[] = { blank.get(), none.get() };
+        r.reset(sum(empty));
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 0.);
+
+        K_ptr jj{ TypeTraits<kChar>::list("jj") }, longs{ TypeTraits<kLong>::list({ 1, 2 }) };
+        ::K simple[] = { jj.get(), longs.get() };
+        r.reset(sum(simple));
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 3.) << "items of a simple list as atoms";
+        K_ptr ff{ TypeTraits<kChar>::list("ff") }, reals{ TypeTraits<kReal>::list({ 1.f, 2.5f }) };
+        ::K promotedReals[] = { ff.get(), reals.get() };
+        r.reset(sum(promotedReals));
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 3.5);
+
+        K_ptr atom{ TypeTraits<kLong>::atom(1) };
+        ::K notList[] = { types.get(), atom.get() };
+        EXPECT_THROW(sum(notList), K_error) << "variadic arguments as a list";
+        K_ptr guid{ ::knk(1, ::ku(::U{})) };
+        ::K notScalar[] = { types.get(), guid.get() };
+        EXPECT_THROW(sum(notScalar), K_error);
+        K_ptr guids{ ::ktn(kGUID, 1) };
+        ::K notScalars[] = { types.get(), guids.get() };
+        EXPECT_THROW(sum(notScalars), K_error);
+    }
+#endif
+
+}//namespace q_ffi
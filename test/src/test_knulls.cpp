@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include "ktype_traits.hpp"
+#include "knulls.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace q
+{
+    namespace
+    {
+        /// @brief Reference, one item at a time (symbols being compared by value, not by address).
+        template<TypeId tid>
+        bool is_null(typename TypeTraits<tid>::value_type v) noexcept
+        {
+            if constexpr (kSymbol == tid)
+                return '\0' == *v;
+            else
+                return TypeTraits<tid>::is_null(v);
+        }
+
+        /// @brief Check the kernels against @c is_null for lists of every length up to a few 256-bit groups,
+        ///     with nulls at every 7th item (so that they fall at all lanes and in partial groups).
+        template<TypeId tid>
+        void check_nulls(typename TypeTraits<tid>::value_type value)
+        {
+            using Traits = TypeTraits<tid>;
+            for (std::size_t n = 0; n <= 70; ++n) {
+                K_ptr list{ ::ktn(tid, static_cast<::J>(n)) };
+                KView<tid> const items{ list.get() };
+                std::size_t nulls = 0;
+                for (std::size_t i = 0; i < n; ++i) {
+                    items[i] = 6 == i % 7 ? Traits::null() : value;
+                    nulls += is_null<tid>(items[i]);
+                }
+                SCOPED_TRACE(n);
+                EXPECT_EQ(count_nulls(items), nulls);
+                EXPECT_EQ(find_first_null(items), n < 7 ? n : 6u);
+
+                K_ptr mask{ null_mask(items) };
+                ASSERT_EQ(type(mask.get()), kBoolean);
+                ASSERT_EQ(count(mask.get()), n);
+                auto const bitmap = null_bitmap(items);
+                ASSERT_EQ(bitmap.size(), (n + 63) / 64);
+                for (std::size_t i = 0; i < n; ++i) {
+                    bool const null = is_null<tid>(items[i]);
+                    EXPECT_EQ(0 != kG(mask.get())[i], null) << i;
+                    EXPECT_EQ(0 != (bitmap[i / 64] & (std::uint64_t{ 1 } << (i % 64))), null) << i;
+                }
+            }
+        }
+
+        template<TypeId tid>
+        void check_infs()
+        {
+            using Traits = TypeTraits<tid>;
+            for (auto const sign : { true, false }) {
+                K_ptr list{ ::ktn(tid, 35) };
+                KView<tid> const items{ list.get() };
+                std::fill(items.begin(), items.end(), Traits::null());
+                EXPECT_FALSE(has_any_inf(items));
+                items[34] = Traits::inf(sign);
+                EXPECT_TRUE(has_any_inf(items)) << "in the partial group";
+                items[34] = Traits::null();
+                items[3] = Traits::inf(sign);
+                EXPECT_TRUE(has_any_inf(items));
+            }
+        }
+
+    }//namespace /*anonymous*/
+
+    TEST(KNullsTests, nulls)
+    {
+        check_nulls<kByte>(0x2a);
+        check_nulls<kChar>('a');
+        check_nulls<kShort>(-1);
+        check_nulls<kInt>(42);
+        check_nulls<kLong>(std::numeric_limits<::J>::max());
+        check_nulls<kReal>(1.5f);
+        check_nulls<kFloat>(-0.);
+        check_nulls<kDate>(0);
+        check_nulls<kTimestamp>(1);
+        check_nulls<kDatetime>(.5);
+        check_nulls<kSymbol>("a");
+    }
+
+    TEST(KNullsTests, nans)
+    {
+        K_ptr reals{ TypeTraits<kReal>::list({
+            std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::quiet_NaN(),
+            std::numeric_limits<float>::signaling_NaN(), TypeTraits<kReal>::null() }) };
+        KView<kReal> const r{ reals.get() };
+        ASSERT_TRUE(TypeTraits<kReal>::is_null(r[3]));
+        EXPECT_EQ(count_nulls(r), std::size_t(std::count_if(r.begin(), r.end(), &TypeTraits<kReal>::is_null)))
+            << "only bit-exact nulls";
+
+        K_ptr floats{ ::ktn(kFloat, 40) };
+        KView<kFloat> const f{ floats.get() };
+        std::uint64_t const payload = 0xFFF8000000000001;
+        double nan;
+        std::memcpy(&nan, &payload, sizeof(nan));
+        std::fill(f.begin(), f.end(), nan);
+        EXPECT_EQ(count_nulls(f), 0u);
+        EXPECT_EQ(find_first_null(f), f.size());
+        f[37] = TypeTraits<kFloat>::null();
+        EXPECT_EQ(count_nulls(f), 1u);
+        EXPECT_EQ(find_first_null(f), 37u);
+        EXPECT_FALSE(has_any_inf(f));
+    }
+
+    TEST(KNullsTests, infs)
+    {
+        check_infs<kShort>();
+        check_infs<kInt>();
+        check_infs<kLong>();
+        check_infs<kReal>();
+        check_infs<kFloat>();
+        check_infs<kMonth>();
+        check_infs<kTimespan>();
+        check_infs<kDatetime>();
+    }
+
+}//namespace q
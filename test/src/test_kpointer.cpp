@@ -10,7 +10,7 @@ namespace q
         K_ptr pk{ TypeTraits<kSymbol>::atom(test_info_->name()) };
         ASSERT_NE(pk.get(), Nil) << "fail to create K object";
 
-        K k = pk.get();
+        K k = pk.release();     // ownership is taken over by pk1 below
         auto refCount = k->r;
         EXPECT_EQ(refCount, 0) << "different initial ref count vs documentation?";
 
@@ -182,7 +182,7 @@ namespace q
         K_ptr pk{ TypeTraits<kSymbol>::atom(test_info_->name()) };
         ASSERT_NE(pk.get(), Nil) << "fail to create K object";
 
-        K k = pk.get();
+        K k = pk.release();     // ownership is taken over by pk1 below
         auto refCount = k->r;
         EXPECT_EQ(refCount, 0) << "different initial ref count vs documentation?";
 
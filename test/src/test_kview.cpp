@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "ktype_traits.hpp"
+#include "kview.hpp"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace q
+{
+
+    TEST(KViewTests, range)
+    {
+        K_ptr list{ TypeTraits<kFloat>::list({ 3., 1., 2. }) };
+        KView<kFloat> const view{ list.get() };
+        ASSERT_EQ(view.size(), 3u);
+        EXPECT_FALSE(view.empty());
+        EXPECT_EQ(view.data(), TypeTraits<kFloat>::index(list.get())) << "no copy";
+        EXPECT_DOUBLE_EQ(std::accumulate(view.begin(), view.end(), 0.), 6.);
+
+        std::sort(view.begin(), view.end());
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(list.get())[0], 1.) << "items updated in place";
+        view[2] = 5.;
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::index(list.get())[2], 5.);
+
+        std_ext::span<double const> const items = view;
+        EXPECT_EQ(items.data(), view.data());
+        EXPECT_EQ(items.size(), 3u);
+
+        K_ptr empty{ ::ktn(kLong, 0) };
+        KView<kLong> const none{ empty.get() };
+        EXPECT_TRUE(none.empty());
+        EXPECT_EQ(none.begin(), none.end());
+    }
+
+    TEST(KViewTests, types)
+    {
+        K_ptr syms{ TypeTraits<kSymbol>::list({ "a", "bc" }) };
+        KView<kSymbol> const view{ syms.get() };
+        EXPECT_STREQ(view[1], "bc");
+
+        K_ptr mixed{ ::knk(2, TypeTraits<kLong>::atom(1), TypeTraits<kChar>::list("xyz")) };
+        KView<kMixed> const items{ mixed.get() };
+        EXPECT_EQ(std::count_if(items.begin(), items.end(), [](::K k) { return 0 > type(k); }), 1);
+
+        K_ptr atom{ TypeTraits<kFloat>::atom(1.) }, ints{ TypeTraits<kInt>::list({ 1 }) };
+        EXPECT_FALSE(KView<kFloat>::is_list(atom.get()));
+        EXPECT_THROW(KView<kFloat>{ atom.get() }, K_error);
+        EXPECT_THROW(KView<kFloat>{ ints.get() }, K_error);
+        EXPECT_THROW(KView<kFloat>{ Nil }, K_error);
+    }
+
+}//namespace q
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include "ktype_traits.hpp"
+#include "kpointer.hpp"
+#include "binding.hpp"
+#include "fptr.hpp"
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+    struct quote_t
+    {
+        char sym[8];
+        std::int32_t size;
+        double bid;
+        double ask;
+        std::int16_t flags[3];
+    };
+
+    double total_spread(quote_t const* quotes, std::int64_t n)
+    {
+        double total = 0.;
+        for (std::int64_t i = 0; i < n; ++i)
+            total += (quotes[i].ask - quotes[i].bid) * quotes[i].size;
+        return total;
+    }
+
+    void fill_quotes(quote_t* quotes, std::int64_t n)
+    {
+        for (std::int64_t i = 0; i < n; ++i) {
+            std::strncpy(quotes[i].sym, 0 == i % 2 ? "IBM" : "MSFT.OQ", sizeof(quotes[i].sym));
+            quotes[i].size = static_cast<std::int32_t>(100 * i);
+            quotes[i].bid = 10. + static_cast<double>(i);
+            quotes[i].ask = 10.5 + static_cast<double>(i);
+            quotes[i].flags[0] = static_cast<std::int16_t>(i);
+        }
+    }
+
+    constexpr char kQuote[] = "sym:c8 size:i bid:f ask:f flags:h3";
+
+    /// @brief Build a table of quotes, with @c n rows.
+    ::K make_quotes(std::size_t n)
+    {
+        using namespace q;
+        K_ptr syms{ ::ktn(kMixed, static_cast<::J>(n)) };
+        K_ptr sizes{ ::ktn(kInt, static_cast<::J>(n)) };
+        K_ptr bids{ ::ktn(kFloat, static_cast<::J>(n)) };
+        K_ptr asks{ ::ktn(kFloat, static_cast<::J>(n)) };
+        K_ptr flags{ ::ktn(kMixed, static_cast<::J>(n)) };
+        for (std::size_t i = 0; i < n; ++i) {
+            kK(syms.get())[i] = TypeTraits<kChar>::list(0 == i % 2 ? "IBM" : "MSFT.OQ");
+            kI(sizes.get())[i] = static_cast<::I>(100 * i);
+            kF(bids.get())[i] = 10. + static_cast<double>(i);
+            kF(asks.get())[i] = 10.5 + static_cast<double>(i);
+            kK(flags.get())[i] = TypeTraits<kShort>::list({ static_cast<::H>(i) });
+        }
+        K_ptr names{ ::ktn(kSymbol, 5) };
+        char const* const cols[] = { "sym", "size", "bid", "ask", "flags" };
+        for (std::size_t i = 0; i < 5; ++i)
+            kS(names.get())[i] = ::ss(const_cast<::S>(cols[i]));
+        return ::xT(::xD(names.release(),
+            ::knk(5, syms.release(), sizes.release(), bids.release(), asks.release(), flags.release())));
+    }
+
+}//namespace /*anonymous*/
+
+namespace q_ffi
+{
+    using namespace q;
+
+    TEST(LayoutTests, offsets)
+    {
+        StructLayout const quote{ kQuote };
+        ASSERT_EQ(quote.fields().size(), 5u);
+        EXPECT_EQ(quote.size(), sizeof(quote_t));
+        EXPECT_EQ(quote.alignment(), alignof(quote_t));
+        EXPECT_EQ(quote.fields()[0].offset, offsetof(quote_t, sym));
+        EXPECT_EQ(quote.fields()[1].offset, offsetof(quote_t, size));
+        EXPECT_EQ(quote.fields()[2].offset, offsetof(quote_t, bid));
+        EXPECT_EQ(quote.fields()[3].offset, offsetof(quote_t, ask));
+        EXPECT_EQ(quote.fields()[4].offset, offsetof(quote_t, flags));
+        EXPECT_EQ(quote.to_str(), "{sym:c8;size:i;bid:f;ask:f;flags:h3}");
+
+        StructLayout const unnamed{ "cjc" };
+        EXPECT_EQ(unnamed.size(), 24u);
+        EXPECT_EQ(unnamed.to_str(), "{x:c;x1:j;x2:c}");
+
+        EXPECT_THROW(StructLayout{ "" }, K_error);
+        EXPECT_THROW(StructLayout{ "a:j a:f" }, K_error);
+        EXPECT_THROW(StructLayout{ "c0" }, K_error);
+        EXPECT_THROW(StructLayout{ "j:" }, K_error);
+        EXPECT_THROW(StructLayout{ "g" }, K_error);
+    }
+
+    TEST(LayoutTests, roundTrip)
+    {
+        StructLayout const quote{ kQuote };
+        constexpr std::size_t n = 1000;     // multiple blocks
+        K_ptr table{ make_quotes(n) };
+        ASSERT_EQ(StructLayout::rows(table.get()), n);
+
+        std::vector<quote_t> quotes(n);
+        quote.pack(table.get(), quotes.data());
+        EXPECT_STREQ(quotes[0].sym, "IBM");
+        EXPECT_STREQ(quotes[999].sym, "MSFT.OQ");
+        EXPECT_EQ(quotes[999].size, 99900);
+        EXPECT_DOUBLE_EQ(quotes[999].ask, 1009.5);
+        EXPECT_EQ(quotes[999].flags[0], 999);
+        EXPECT_EQ(quotes[999].flags[2], 0) << "shorter lists padded with zeros";
+
+        K_ptr back{ quote.unpack(quotes.data(), n) };
+        ASSERT_EQ(type(back.get()), kTable);
+        ASSERT_EQ(StructLayout::rows(back.get()), n);
+        auto const cols = kK(kK(back.get()->k)[1]);
+        EXPECT_EQ(q2Str(kK(cols[0])[1]), "MSFT.OQ");
+        EXPECT_EQ(kI(cols[1])[999], 99900);
+        EXPECT_DOUBLE_EQ(kF(cols[2])[999], 1009.);
+        ASSERT_EQ(count(kK(cols[4])[999]), 3u);
+        EXPECT_EQ(kH(kK(cols[4])[999])[0], 999);
+        EXPECT_STREQ(kS(kK(back.get()->k)[0])[4], "flags");
+    }
+
+    TEST(LayoutTests, mismatch)
+    {
+        K_ptr table{ make_quotes(2) };
+        std::vector<quote_t> quotes(2);
+        EXPECT_THROW(StructLayout{ "sym:c8 size:j bid:f ask:f flags:h3" }.pack(table.get(), quotes.data()), K_error);
+        EXPECT_THROW(StructLayout{ "sym:c2 size:i bid:f ask:f flags:h3" }.pack(table.get(), quotes.data()), K_error);
+        EXPECT_THROW(StructLayout{ "sym:c8 size:i bid:f ask:f" }.pack(table.get(), quotes.data()), K_error);
+        K_ptr list{ TypeTraits<kLong>::list({ 1, 2 }) };
+        EXPECT_THROW(StructLayout::rows(list.get()), K_error);
+    }
+
+    TEST(LayoutTests, binding)
+    {
+        Binding spread{ fptr(&total_spread), Signature("f", std::string("{") + kQuote + "}#") };
+        EXPECT_EQ(spread.rank(), 1u);
+        EXPECT_EQ(spread.signature().to_str(), "f({sym:c8;size:i;bid:f;ask:f;flags:h3}#)");
+        K_ptr table{ make_quotes(4) };
+        ::K args[] = { table.get() };
+        K_ptr r{ spread(args) };
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), .5 * (0 + 100 + 200 + 300));
+
+        Binding fill{ fptr(&fill_quotes), Signature(" ", std::string(">{") + kQuote + "}3j") };
+        EXPECT_EQ(fill.rank(), 1u);
+        K_ptr n{ TypeTraits<kLong>::atom(3) };
+        args[0] = n.get();
+        r.reset(fill(args));
+        ASSERT_EQ(type(r.get()), kTable);
+        ASSERT_EQ(StructLayout::rows(r.get()), 3u);
+        auto const cols = kK(kK(r.get()->k)[1]);
+        EXPECT_EQ(q2Str(kK(cols[0])[2]), "IBM");
+        EXPECT_DOUBLE_EQ(kF(cols[3])[1], 11.5);
+    }
+
+}//namespace q_ffi
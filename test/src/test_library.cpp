@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "ktype_traits.hpp"
+#include "kpointer.hpp"
+#include "library.hpp"
+#include "binding.hpp"
+#include "ffi.h"
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+namespace q_ffi
+{
+    using namespace q;
+
+    TEST(LibraryTests, cache)
+    {
+        auto const libm = Library::open("libm.so.6");
+        ASSERT_NE(libm, nullptr);
+        EXPECT_EQ(Library::open("libm.so.6"), libm);
+        EXPECT_EQ(libm->path().front(), '/') << "canonical path expected: " << libm->path();
+        EXPECT_EQ(Library::open(libm->path()), libm) << "same library through another path";
+
+        auto const pow = libm->resolve("pow");
+        EXPECT_NE(pow, nullptr);
+        EXPECT_EQ(libm->resolve("pow"), pow);
+        EXPECT_THROW(libm->resolve("no_such_function"), K_error);
+
+        auto const host = Library::open("");
+        EXPECT_TRUE(host->path().empty());
+        EXPECT_NE(host->resolve("malloc"), nullptr);
+
+        EXPECT_THROW(Library::open("no_such_library.so"), K_error);
+    }
+
+    TEST(LibraryTests, unload)
+    {
+        std::weak_ptr<Library> weak = Library::open("libm.so.6");
+        EXPECT_FALSE(weak.expired()) << "pinned by the cache";
+
+        auto const lib = weak.lock();
+        Binding binding{ lib->resolve("pow"), Signature("f", "ff"), lib };
+        EXPECT_TRUE(Library::unload("libm.so.6"));
+        EXPECT_FALSE(Library::unload("libm.so.6")) << "already unloaded";
+        EXPECT_FALSE(Library::unload("no_such_library.so"));
+
+        EXPECT_FALSE(weak.expired()) << "still used by a binding";
+        {
+            auto const copy = weak.lock();
+            EXPECT_EQ(copy.use_count(), 3);
+        }
+        auto const reopened = Library::open("libm.so.6");
+        EXPECT_EQ(reopened, lib) << "reopened while still in use";
+        EXPECT_TRUE(Library::unload("libm.so.6"));
+    }
+
+    TEST(LibraryTests, lastBinding)
+    {
+        K_ptr dll{ TypeTraits<kSymbol>::atom(":libm.so.6") }, fn{ TypeTraits<kSymbol>::atom("cbrt") },
+            res{ TypeTraits<kChar>::atom('f') }, params{ TypeTraits<kChar>::list("f") };
+        K_ptr options{ ::xD(TypeTraits<kSymbol>::list({ "flags" }),
+            ::knk(1, TypeTraits<kSymbol>::list({ "lazy", "global" }))) };
+        K_ptr b{ ::load(dll.get(), fn.get(), res.get(), params.get(), options.get()) };
+        ASSERT_EQ(type(b.get()), kForeign);
+
+        std::weak_ptr<Library> weak = Library::open("libm.so.6");
+        K_ptr unloaded{ ::unload(dll.get()) };
+        ASSERT_EQ(type(unloaded.get()), -kBoolean);
+        EXPECT_TRUE(TypeTraits<kBoolean>::value(unloaded.get()));
+        EXPECT_FALSE(weak.expired());
+
+        b.reset();
+        EXPECT_TRUE(weak.expired()) << "closed with the last binding";
+
+        options.reset(::xD(TypeTraits<kSymbol>::list({ "flags" }),
+            ::knk(1, TypeTraits<kSymbol>::atom("bogus"))));
+        EXPECT_EQ(::load(dll.get(), fn.get(), res.get(), params.get(), options.get()), Nil);
+    }
+
+    TEST(LibraryTests, exports)
+    {
+        auto const libm = Library::open("libm.so.6");
+        auto const& elf = libm->exports();
+        auto const symbols = elf.list();
+        EXPECT_LT(100u, symbols.size());
+        auto const cbrt = std::find_if(symbols.cbegin(), symbols.cend(),
+            [](ElfExports::Symbol const& s) { return 0 == std::strcmp(s.name, "cbrt"); });
+        ASSERT_NE(cbrt, symbols.cend());
+        EXPECT_EQ(cbrt->kind, ElfExports::Kind::function);
+        EXPECT_EQ(cbrt->address, ::dlsym(RTLD_DEFAULT, "cbrt")) << "same as dlsym";
+        EXPECT_EQ(elf.find("cbrt"), cbrt->address);
+        EXPECT_EQ(to_function(elf.find("pow")), libm->resolve("pow")) << "default version";
+        EXPECT_EQ(elf.find("malloc"), nullptr) << "only the library's own exports";
+        EXPECT_EQ(elf.find("no_such_function"), nullptr);
+
+        auto const found = elf.find_all({ "erf", "no_such_function", "cbrt", "floor", "erf" });
+        ASSERT_EQ(found.size(), 5u);
+        EXPECT_EQ(found[0], ::dlsym(RTLD_DEFAULT, "erf"));
+        EXPECT_EQ(found[1], nullptr);
+        EXPECT_EQ(found[2], cbrt->address);
+        EXPECT_EQ(found[3], nullptr) << "indirect function, left to dlsym";
+        EXPECT_EQ(found[4], found[0]);
+
+        auto const fns = libm->resolve(std::vector<std::string>{ "erf", "floor", "malloc" });
+        EXPECT_EQ(fns[0], to_function(found[0]));
+        EXPECT_EQ(fns[1], to_function(::dlsym(RTLD_DEFAULT, "floor")));
+        EXPECT_EQ(fns[2], Library::open("")->resolve("malloc")) << "dependencies through dlsym";
+        EXPECT_THROW(libm->resolve(std::vector<std::string>{ "erf", "no_such_function" }), K_error);
+
+        K_ptr dll{ TypeTraits<kSymbol>::atom(":libm.so.6") };
+        K_ptr table{ ::exports(dll.get()) };
+        ASSERT_EQ(type(table.get()), kTable);
+        auto const columns = kK(table->k)[1];
+        EXPECT_EQ(count(kK(columns)[0]), symbols.size());
+    }
+
+}//namespace q_ffi
+#endif
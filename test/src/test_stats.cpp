@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "ktype_traits.hpp"
+#include "kpointer.hpp"
+#include "binding.hpp"
+#include "stats.hpp"
+#include "fptr.hpp"
+#include <thread>
+#include <vector>
+
+namespace
+{
+    double sum_all(double const* values, std::int64_t n)
+    {
+        double sum = 0.;
+        for (std::int64_t i = 0; i < n; ++i)
+            sum += values[i];
+        return sum;
+    }
+
+    /// @brief Switch statistics on for the scope of a test.
+    struct Profiling
+    {
+        Profiling() noexcept : saved{ q_ffi::CallStats::enable(true) }
+        {}
+
+        ~Profiling()
+        { q_ffi::CallStats::enable(saved); }
+
+        bool saved;
+    };
+
+}//namespace /*anonymous*/
+
+namespace q_ffi
+{
+    using namespace q;
+
+    TEST(StatsTests, counters)
+    {
+        BindingOptions options;
+        options.name = "sum_all";
+        Binding sum{ fptr(&sum_all), Signature("f", "F#"), nullptr, options };
+        K_ptr values{ TypeTraits<kFloat>::list({ 1., 2., 3., 4. }) };
+        ::K args[] = { values.get() };
+
+        CallStats::enable(false);
+        K_ptr r{ sum(args) };
+        EXPECT_EQ(sum.stats().totals().calls, 0u) << "not collected while off";
+
+        Profiling on;
+        r.reset(sum(args));
+        K_ptr list{ ::knk(1, ::r1(values.get())) };
+        r.reset(sum.apply(list.get()));
+        K_ptr wrong{ TypeTraits<kLong>::list({ 1, 2 }) };
+        args[0] = wrong.get();
+        EXPECT_THROW(K_ptr(sum(args)), K_error);
+
+        auto const totals = sum.stats().totals();
+        EXPECT_EQ(totals.calls, 3u);
+        EXPECT_EQ(totals.errors, 1u);
+        EXPECT_EQ(totals.bytes_in, 2 * 4 * sizeof(double));
+        EXPECT_EQ(totals.bytes_out, 2 * sizeof(double));
+        EXPECT_LE(totals.max_nanos, totals.nanos);
+    }
+
+    TEST(StatsTests, table)
+    {
+        BindingOptions options;
+        options.name = "sum_all";
+        Binding sum{ fptr(&sum_all), Signature("f", "F#"), nullptr, options };
+        Profiling on;
+        K_ptr values{ TypeTraits<kFloat>::list({ 1., 2. }) };
+        K_ptr list{ ::knk(1, ::r1(values.get())) };
+        K_ptr r{ sum.apply(list.get()) };
+
+        CallStats threaded{ "threaded" };
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&threaded, t] {
+                for (int i = 0; i < 100; ++i)
+                    threaded.record(10 * t, 1, 1);
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+
+        K_ptr table{ CallStats::table() };
+        ASSERT_EQ(type(table.get()), kTable);
+        auto const keys = kK(table->k)[0];
+        auto const columns = kK(table->k)[1];
+        ASSERT_EQ(count(keys), 7);
+        EXPECT_STREQ(kS(keys)[1], "calls");
+        auto const names = kK(columns)[0];
+        auto const n = static_cast<std::size_t>(count(names));
+        ASSERT_LE(2u, n);
+        EXPECT_STREQ(kS(names)[n - 2], "sum_all");
+        EXPECT_STREQ(kS(names)[n - 1], "threaded");
+        EXPECT_EQ(kJ(kK(columns)[1])[n - 2], 1);
+        EXPECT_EQ(kJ(kK(columns)[4])[n - 2], 2 * 8);
+        EXPECT_EQ(kJ(kK(columns)[1])[n - 1], 400);
+        EXPECT_EQ(kJ(kK(columns)[2])[n - 1], 100 * (0 + 10 + 20 + 30));
+        EXPECT_EQ(kJ(kK(columns)[3])[n - 1], 30);
+
+        CallStats::reset_all();
+        EXPECT_EQ(sum.stats().totals().calls, 0u);
+        EXPECT_EQ(threaded.totals().bytes_out, 0u);
+    }
+
+}//namespace q_ffi
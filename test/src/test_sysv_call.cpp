@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include "ktype_traits.hpp"
+#include "kpointer.hpp"
+#include "binding.hpp"
+#include "fptr.hpp"
+#include <cstring>
+#include <vector>
+
+#ifdef q_ffi_SYSV_CALL
+namespace
+{
+    using I64 = std::int64_t;
+
+    I64 sum_j8(I64 a, I64 b, I64 c, I64 d, I64 e, I64 f, I64 g, I64 h)
+    { return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f + 7 * g + 8 * h; }
+
+    I64 sum_j7(I64 a, I64 b, I64 c, I64 d, I64 e, I64 f, I64 g)
+    { return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f + 7 * g; }
+
+    double sum_f10(double a, double b, double c, double d, double e,
+        double f, double g, double h, double i, double j)
+    { return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f + 7 * g + 8 * h + 9 * i + 10 * j; }
+
+    float sum_e9(float a, float b, float c, float d, float e, float f, float g, float h, float i)
+    { return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f + 7 * g + 8 * h + 9 * i; }
+
+    // 7 integers & 9 doubles, interleaved: the last of each class spill onto the stack
+    double spill_mixed(I64 a1, double d1, I64 a2, double d2, I64 a3, double d3, I64 a4, double d4,
+        I64 a5, double d5, I64 a6, double d6, double d7, double d8, I64 a7, double d9)
+    {
+        return (a1 + 2 * a2 + 3 * a3 + 4 * a4 + 5 * a5 + 6 * a6 + 7 * a7) * 1000.
+            + d1 + 2 * d2 + 3 * d3 + 4 * d4 + 5 * d5 + 6 * d6 + 7 * d7 + 8 * d8 + 9 * d9;
+    }
+
+    // Narrow integers and floats passed on the stack
+    double narrow_stack(I64 a, I64 b, I64 c, I64 d, I64 e, I64 f, std::int16_t h, std::int32_t i, unsigned char x, float y)
+    { return static_cast<double>(a + b + c + d + e + f) + h * 10. + i * 100. + x * 1000. + y; }
+
+    char const* nth_word(I64 n, char const* s0, char const* s1, char const* s2, char const* s3,
+        char const* s4, char const* s5, char const* s6, char const* s7)
+    {
+        char const* words[] = { s0, s1, s2, s3, s4, s5, s6, s7 };
+        return words[n];
+    }
+
+    I64 sink[12];
+    void store_j12(I64 a, I64 b, I64 c, I64 d, I64 e, I64 f, I64 g, I64 h, I64 i, I64 j, I64 k, I64 l)
+    {
+        I64 const v[] = { a, b, c, d, e, f, g, h, i, j, k, l };
+        std::memcpy(sink, v, sizeof(v));
+    }
+
+}//namespace /*anonymous*/
+
+namespace q_ffi
+{
+    using namespace q;
+
+    TEST(SysVCallTests, plan)
+    {
+        CallPlan plan{ Signature("f", "jfjfjfjfjfjfffjf") };
+        EXPECT_EQ(plan.int_regs(), 6u);
+        EXPECT_EQ(plan.sse_regs(), 8u);
+        EXPECT_EQ(plan.stack_words(), 2u);
+        std::vector<std::size_t> const expected{
+            0, 6, 1, 7, 2, 8, 3, 9, 4, 10, 5, 11, 12, 13, CallPlan::kStackBase, CallPlan::kStackBase + 1 };
+        EXPECT_EQ(plan.layout(), expected);
+
+        CallPlan empty{ Signature(" ", "") };
+        EXPECT_EQ(empty.int_regs() + empty.sse_regs() + empty.stack_words(), 0u);
+
+        EXPECT_FALSE(Invoker(Signature("f", "ffffff")).is_planned());
+        EXPECT_TRUE(Invoker(Signature("f", "fffffff")).is_planned());
+    }
+
+    TEST(SysVCallTests, integers)
+    {
+        CallPlan plan8{ Signature("j", "jjjjjjjj") };
+        Slot const args[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        EXPECT_EQ(plan8(fptr(&sum_j8), args), 204u) << "even number of stack words";
+
+        CallPlan plan7{ Signature("j", "jjjjjjj") };
+        EXPECT_EQ(plan7(fptr(&sum_j7), args), 140u) << "odd number of stack words";
+
+        Slot const negs[] = { 0, 0, 0, 0, 0, 0, static_cast<Slot>(-1), static_cast<Slot>(-2) };
+        EXPECT_EQ(static_cast<I64>(plan8(fptr(&sum_j8), negs)), -23);
+    }
+
+    TEST(SysVCallTests, floats)
+    {
+        Binding sum{ fptr(&sum_f10), Signature("f", "ffffffffff") };
+        K_ptr args{ TypeTraits<kFloat>::list({ 1., 1., 1., 1., 1., 1., 1., 1., 1., .5 }) };
+        K_ptr r{ sum.apply(args.get()) };
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 50.);
+
+        Binding sume{ fptr(&sum_e9), Signature("e", "eeeeeeeee") };
+        args.reset(TypeTraits<kReal>::list({ 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, .5f }));
+        r.reset(sume.apply(args.get()));
+        ASSERT_EQ(type(r.get()), -kReal);
+        EXPECT_FLOAT_EQ(TypeTraits<kReal>::value(r.get()), 40.5f);
+    }
+
+    TEST(SysVCallTests, mixed)
+    {
+        Binding spill{ fptr(&spill_mixed), Signature("f", "jfjfjfjfjfjfffjf") };
+        K_ptr args{ ::ktn(kMixed, 16) };
+        I64 a = 1;
+        double const d = .5;
+        auto items = TypeTraits<kMixed>::index(args.get());
+        std::string const types{ "jfjfjfjfjfjfffjf" };
+        for (std::size_t i = 0; i < types.size(); ++i)
+            items[i] = 'j' == types[i] ? TypeTraits<kLong>::atom(a++) : TypeTraits<kFloat>::atom(d);
+        K_ptr r{ spill.apply(args.get()) };
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 140000. + 22.5);
+
+        Binding narrow{ fptr(&narrow_stack), Signature("f", "jjjjjjhibe") };
+        args.reset(::knk(10,
+            TypeTraits<kLong>::atom(1), TypeTraits<kLong>::atom(1), TypeTraits<kLong>::atom(1),
+            TypeTraits<kLong>::atom(1), TypeTraits<kLong>::atom(1), TypeTraits<kLong>::atom(1),
+            TypeTraits<kShort>::atom(-3), TypeTraits<kInt>::atom(-2),
+            TypeTraits<kBoolean>::atom(true), TypeTraits<kReal>::atom(.25f)));
+        r.reset(narrow.apply(args.get()));
+        ASSERT_EQ(type(r.get()), -kFloat);
+        EXPECT_DOUBLE_EQ(TypeTraits<kFloat>::value(r.get()), 6. - 30. - 200. + 1000. + .25);
+    }
+
+    TEST(SysVCallTests, pointers)
+    {
+        Binding nth{ fptr(&nth_word), Signature("s", "jssssssss") };
+        K_ptr args{ ::knk(9, TypeTraits<kLong>::atom(7),
+            TypeTraits<kSymbol>::atom("s0"), TypeTraits<kSymbol>::atom("s1"), TypeTraits<kSymbol>::atom("s2"),
+            TypeTraits<kSymbol>::atom("s3"), TypeTraits<kSymbol>::atom("s4"), TypeTraits<kSymbol>::atom("s5"),
+            TypeTraits<kSymbol>::atom("s6"), TypeTraits<kChar>::list("last")) };
+        K_ptr r{ nth.apply(args.get()) };
+        ASSERT_EQ(type(r.get()), -kSymbol);
+        EXPECT_STREQ(TypeTraits<kSymbol>::value(r.get()), "last");
+
+        TypeTraits<kLong>::value(kK(args.get())[0]) = 6;
+        r.reset(nth.apply(args.get()));
+        EXPECT_STREQ(TypeTraits<kSymbol>::value(r.get()), "s6");
+    }
+
+    TEST(SysVCallTests, voidResult)
+    {
+        Binding store{ fptr(&store_j12), Signature(" ", "jjjjjjjjjjjj") };
+        EXPECT_EQ(store.rank(), 12u);
+        K_ptr args{ TypeTraits<kLong>::list({ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 }) };
+        std::memset(sink, 0, sizeof(sink));
+        EXPECT_EQ(store.apply(args.get()), Nil);
+        for (std::size_t i = 0; i < 12; ++i)
+            EXPECT_EQ(sink[i], static_cast<I64>(i + 1));
+    }
+
+}//namespace q_ffi
+#endif
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include "workers.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace q_ffi
+{
+    class WorkerPoolTests : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            saved_ = WorkerPool::instance().size();
+            WorkerPool::instance().resize(3);
+        }
+
+        void TearDown() override
+        {
+            WorkerPool::instance().resize(saved_);
+        }
+
+    private:
+        std::size_t saved_ = 0;
+    };
+
+    TEST_F(WorkerPoolTests, partitions)
+    {
+        auto& pool = WorkerPool::instance();
+        ASSERT_EQ(pool.size(), 3u);
+
+        std::vector<int> hits(1000, 0);
+        std::atomic<int> partitions{ 0 };
+        pool.run(hits.size(), 100, [&](std::size_t begin, std::size_t end) {
+            ++partitions;
+            for (auto i = begin; i < end; ++i)
+                ++hits[i];
+        });
+        EXPECT_EQ(partitions, 4);
+        for (auto h : hits)
+            ASSERT_EQ(h, 1);
+
+        partitions = 0;
+        pool.run(150, 100, [&](std::size_t begin, std::size_t end) {
+            ++partitions;
+            EXPECT_EQ(begin, 0u);
+            EXPECT_EQ(end, 150u);
+        });
+        EXPECT_EQ(partitions, 1) << "too small to be split";
+    }
+
+    TEST_F(WorkerPoolTests, errors)
+    {
+        auto& pool = WorkerPool::instance();
+        EXPECT_THROW(pool.run(400, 100, [](std::size_t begin, std::size_t) {
+            if (200 <= begin)
+                throw std::runtime_error("failed");
+        }), std::runtime_error);
+
+        std::atomic<std::size_t> total{ 0 };
+        pool.run(400, 100, [&](std::size_t begin, std::size_t end) { total += end - begin; });
+        EXPECT_EQ(total, 400u) << "pool still usable after an error";
+    }
+
+}//namespace q_ffi